@@ -0,0 +1,717 @@
+/*
+ * File              : FemtoCuts.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOCUTS_H
+#define FEMTOCUTS_H
+
+#include <RtypesCore.h>
+#include <TH1D.h>
+#include <TList.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "FemtoDerived.h"
+#include "FemtoReader.h"
+
+// bit i of a mask is set if the particle passes cut set i
+typedef ULong64_t CutMask;
+static constexpr Int_t kMaxCutSets = 64;
+
+// sections of a cut config, e.g. StandardCuts.json
+enum CutSpecies {
+  kCutEvent = 0,
+  kCutProton,
+  kCutDeuteron,
+  kCutLambda,
+  kCutPosDaughter,
+  kCutNegDaughter,
+  kNCutSpecies
+};
+
+static const char *kCutSpeciesName[kNCutSpecies] = {
+    "Event", "Proton", "Deuteron", "Lambda", "PosDaughter", "NegDaughter"};
+
+// a cut is either a window the value has to be inside or, for vetoes, a window
+// the value must not be inside
+// gated cuts only apply below or above the momentum given by Proton_PTPC
+enum CutMode { kCutInside = 0, kCutOutside };
+enum CutGate { kGateNone = 0, kGateBelowPTPC, kGateAbovePTPC };
+
+// translation of a key of the cut config into cuts on variables
+// keys with several rules are expanded into several cuts
+struct CutRule {
+  const char *Key;
+  Int_t Species; // -1 for all species
+  CutVariable Variable;
+  CutMode Mode;
+  CutGate Gate;
+};
+
+static const std::vector<CutRule> kCutRules = {
+    {"VertexZ", kCutEvent, kVarVertexZ, kCutInside, kGateNone},
+    {"Multiplicity", kCutEvent, kVarMultiplicity, kCutInside, kGateNone},
+    {"Charge", -1, kVarCharge, kCutInside, kGateNone},
+    {"Pt", -1, kVarPt, kCutInside, kGateNone},
+    {"Eta", -1, kVarEta, kCutInside, kGateNone},
+    {"DCAxy", -1, kVarDCAxy, kCutInside, kGateNone},
+    {"DCAz", -1, kVarDCAz, kCutInside, kGateNone},
+    {"TPCClustersFound", -1, kVarTPCClustersFound, kCutInside, kGateNone},
+    {"TPCCrossedRows", -1, kVarTPCCrossedRows, kCutInside, kGateNone},
+    {"TPCCrossedRowsOverFindable", -1, kVarTPCCrossedRowsOverFindable,
+     kCutInside, kGateNone},
+    {"TPCClustersShared", -1, kVarTPCClustersShared, kCutInside, kGateNone},
+    {"ITSClusters", -1, kVarITSClusters, kCutInside, kGateNone},
+    {"ITSClustersIB", -1, kVarITSClustersIB, kCutInside, kGateNone},
+    {"NSigmaTPC", kCutProton, kVarNSigmaTPCPr, kCutInside, kGateBelowPTPC},
+    {"NSigmaTPCTOF", kCutProton, kVarNSigmaTPCTOFPr, kCutInside,
+     kGateAbovePTPC},
+    {"NSigmaTPC", kCutDeuteron, kVarNSigmaTPCDe, kCutInside, kGateNone},
+    {"TPCRejection", kCutDeuteron, kVarNSigmaTPCPr, kCutOutside, kGateNone},
+    {"TPCRejection", kCutDeuteron, kVarNSigmaTPCPi, kCutOutside, kGateNone},
+    {"TPCRejection", kCutDeuteron, kVarNSigmaTPCEl, kCutOutside, kGateNone},
+    {"NSigmaTPC", kCutPosDaughter, kVarNSigmaTPCPr, kCutInside, kGateNone},
+    {"NSigmaTPC", kCutNegDaughter, kVarNSigmaTPCPi, kCutInside, kGateNone},
+    {"DCAPrimaryVertex", -1, kVarDCAPrimaryVertex, kCutOutside, kGateNone},
+    {"CosPA", -1, kVarCosPA, kCutInside, kGateNone},
+    {"TransRadius", -1, kVarTransRadius, kCutInside, kGateNone},
+    {"DecayVertexDist", -1, kVarDecayVertexDist, kCutInside, kGateNone},
+    {"DaughterDCA", -1, kVarDaughterDCA, kCutInside, kGateNone},
+    {"LambdaInvMass", -1, kVarLambdaInvMass, kCutInside, kGateNone},
+    {"K0InvMass", -1, kVarK0InvMass, kCutOutside, kGateNone},
+};
+
+// one compiled cut, Min and Max are inclusive
+struct CutInstruction {
+  CutVariable Variable;
+  Double_t Min, Max;
+  CutMode Mode;
+  CutGate Gate;
+  Double_t Threshold;
+};
+
+// candidates of a species and how many of them each cut rejected
+// Rejected is indexed like the program of the species, a candidate counts for
+// the first cut it fails in the order the cuts are evaluated
+// Sampled and Failed are collected while sampling for the adaptive cut order,
+// Failed counts every cut a candidate fails
+struct CutFlow {
+  Long64_t Candidates = 0;
+  std::vector<Long64_t> Rejected;
+  Long64_t Sampled = 0;
+  std::vector<Long64_t> Failed;
+};
+
+// selection of the particles of one batch, entry j belongs to row Begin + j
+// Event holds the mask of the collision the particle belongs to
+// RawTrack and RawV0 are all tracks and V0s of selected collisions
+// a Lambda only passes together with both of its daughters
+struct SelectionMasks {
+  std::vector<CutMask> Event, RawTrack, RawV0, Proton, Deuteron, Lambda;
+};
+
+class FemtoCuts {
+public:
+  // every config file is compiled into one cut set
+  // bit i of all masks belongs to the cut set of ConfigFiles[i]
+  explicit FemtoCuts(const std::vector<std::string> &ConfigFiles) {
+
+    if (ConfigFiles.size() > static_cast<std::size_t>(kMaxCutSets)) {
+      std::cout << "Only " << kMaxCutSets
+                << " cut sets can be processed at once. Skip the rest..."
+                << std::endl;
+    }
+
+    for (const auto &ConfigFile : ConfigFiles) {
+      if (fCutSets.size() == static_cast<std::size_t>(kMaxCutSets)) {
+        break;
+      }
+
+      std::fstream Jfile(ConfigFile);
+      nlohmann::json Jconfig = nlohmann::json::parse(Jfile);
+
+      CutSet Set;
+      Set.Name = CutSetName(ConfigFile);
+      Double_t PTPC = Jconfig.value("Proton_PTPC", 0.);
+      for (Int_t s = 0; s < kNCutSpecies; s++) {
+        if (Jconfig.contains(kCutSpeciesName[s])) {
+          Set.Programs[s] = Compile(s, Jconfig[kCutSpeciesName[s]], PTPC);
+        }
+      }
+      fCutSets.push_back(Set);
+    }
+
+    Prepare();
+  }
+
+  // a single cut set from already compiled programs, one per species
+  FemtoCuts(const std::string &Name,
+            const std::vector<CutInstruction> (&Programs)[kNCutSpecies]) {
+    CutSet Set;
+    Set.Name = Name;
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      Set.Programs[s] = Programs[s];
+    }
+    fCutSets.push_back(Set);
+    Prepare();
+  }
+
+  Int_t NCutSets() const { return fCutSets.size(); }
+
+  // name of a cut set, e.g. StandardCuts.json -> StandardCuts
+  const std::string &Name(Int_t CutSet) const { return fCutSets[CutSet].Name; }
+
+  // compiled cuts of a cut set for one species
+  const std::vector<CutInstruction> &Program(Int_t CutSet,
+                                             Int_t Species) const {
+    return fCutSets[CutSet].Programs[Species];
+  }
+
+  // loosest envelope of all cut sets as a single cut set, everything passing
+  // one of the cut sets passes the envelope as well
+  // only cuts present in every cut set are kept, windows are widened to cover
+  // all of them and vetoes are narrowed to the range common to all of them
+  FemtoCuts Envelope() const {
+    std::vector<CutInstruction> Programs[kNCutSpecies];
+    for (Int_t s = 0; s < kNCutSpecies && !fCutSets.empty(); s++) {
+      for (const auto &Cut : fCutSets[0].Programs[s]) {
+        CutInstruction Loose = Cut;
+        Bool_t Common = true;
+        for (std::size_t c = 1; c < fCutSets.size() && Common; c++) {
+          Common = false;
+          for (const auto &Other : fCutSets[c].Programs[s]) {
+            if (!SameCut(Cut, Other)) {
+              continue;
+            }
+            Common = true;
+            if (Cut.Mode == kCutInside) {
+              Loose.Min = std::min(Loose.Min, Other.Min);
+              Loose.Max = std::max(Loose.Max, Other.Max);
+            } else {
+              Loose.Min = std::max(Loose.Min, Other.Min);
+              Loose.Max = std::min(Loose.Max, Other.Max);
+            }
+            break;
+          }
+        }
+        if (Common && (Loose.Mode == kCutInside || Loose.Min <= Loose.Max)) {
+          Programs[s].push_back(Loose);
+        }
+      }
+    }
+    return FemtoCuts("Envelope", Programs);
+  }
+
+  // check if every cut set of Other lies inside the first cut set of this one,
+  // so whatever passes one of them also passes this one
+  Bool_t Contains(const FemtoCuts &Other) const {
+    if (fCutSets.empty()) {
+      return false;
+    }
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      for (const auto &Cut : fCutSets[0].Programs[s]) {
+        for (const auto &Set : Other.fCutSets) {
+          Bool_t Inside = std::any_of(
+              Set.Programs[s].begin(), Set.Programs[s].end(),
+              [&Cut](const CutInstruction &Tight) {
+                if (!SameCut(Cut, Tight)) {
+                  return false;
+                }
+                return Cut.Mode == kCutInside
+                           ? Cut.Min <= Tight.Min && Tight.Max <= Cut.Max
+                           : Tight.Min <= Cut.Min && Cut.Max <= Tight.Max;
+              });
+          if (!Inside) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // while sampling every cut is checked against all candidates and counts
+  // the candidates it fails on its own
+  void SetSampling(Bool_t Sampling) { fSampling = Sampling; }
+
+  // check if every species with cuts saw at least N candidates while sampling
+  Bool_t Sampled(Long64_t N) const {
+    for (const auto &Set : fCutSets) {
+      for (Int_t s = 0; s < kNCutSpecies; s++) {
+        if (!Set.Programs[s].empty() && Set.Flow[s].Sampled < N) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // take over the cut order of Sample, ordered by what it rejected while
+  // sampling, so the cuts rejecting most per cost are evaluated first
+  // the selection does not depend on the order, only the attribution of the
+  // rejections in the cut flow does
+  // afterwards every cut only loads its variable for the rows passing the cuts
+  // before it, so a cut rejecting early saves the loads of the later ones
+  void AdaptOrder(const FemtoCuts &Sample) {
+    for (std::size_t c = 0; c < fCutSets.size(); c++) {
+      for (Int_t s = 0; s < kNCutSpecies; s++) {
+        CutFlow &Flow = fCutSets[c].Flow[s];
+        Flow.Sampled = Sample.fCutSets[c].Flow[s].Sampled;
+        Flow.Failed = Sample.fCutSets[c].Flow[s].Failed;
+        Reorder(fCutSets[c], s);
+      }
+    }
+    fAdaptive = true;
+  }
+
+  // add the cut flow counted by another copy of the same cuts with the same
+  // order
+  void MergeCutFlow(const FemtoCuts &Other) {
+    for (std::size_t c = 0; c < fCutSets.size(); c++) {
+      for (Int_t s = 0; s < kNCutSpecies; s++) {
+        CutFlow &Flow = fCutSets[c].Flow[s];
+        const CutFlow &OtherFlow = Other.fCutSets[c].Flow[s];
+        Flow.Candidates += OtherFlow.Candidates;
+        for (std::size_t k = 0; k < Flow.Rejected.size(); k++) {
+          Flow.Rejected[k] += OtherFlow.Rejected[k];
+        }
+      }
+    }
+  }
+
+  // names of the cuts of a species in the order they are evaluated
+  std::vector<std::string> Order(Int_t CutSet, Int_t Species) const {
+    std::vector<std::string> Labels;
+    for (auto k : fCutSets[CutSet].Order[Species]) {
+      const CutInstruction &Cut = fCutSets[CutSet].Programs[Species][k];
+      Labels.push_back(CutLabel(Species, Cut));
+    }
+    return Labels;
+  }
+
+  const CutFlow &Flow(Int_t CutSet, Int_t Species) const {
+    return fCutSets[CutSet].Flow[Species];
+  }
+
+  // name of a cut in the cut flow, the key of the config
+  // keys expanded into several cuts are numbered in the order of kCutRules
+  static std::string CutLabel(Int_t Species, const CutInstruction &Cut) {
+    std::vector<const CutRule *> Rules;
+    for (const auto &Rule : kCutRules) {
+      if (Rule.Species < 0 || Rule.Species == Species) {
+        Rules.push_back(&Rule);
+      }
+    }
+    for (const auto *Rule : Rules) {
+      if (Rule->Variable != Cut.Variable || Rule->Mode != Cut.Mode ||
+          Rule->Gate != Cut.Gate) {
+        continue;
+      }
+      std::string Label = Rule->Key;
+      Int_t NRules = 0, Index = 0;
+      for (const auto *Other : Rules) {
+        if (Label == Other->Key) {
+          Index = Other == Rule ? NRules : Index;
+          NRules++;
+        }
+      }
+      return NRules > 1 ? Label + " " + std::to_string(Index + 1) : Label;
+    }
+    return "Unknown";
+  }
+
+  // cut flow of a cut set, one histogram per species holding the number of
+  // candidates, the candidates rejected by each cut in the order the cuts are
+  // evaluated and the passing ones
+  TList *GetCutFlowList(Int_t CutSet) const {
+    TList *List = new TList();
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      const auto &Program = fCutSets[CutSet].Programs[s];
+      const auto &Order = fCutSets[CutSet].Order[s];
+      const CutFlow &Flow = fCutSets[CutSet].Flow[s];
+      Int_t NBins = Program.size() + 2;
+      TH1D *Hist = new TH1D(kCutSpeciesName[s], kCutSpeciesName[s], NBins, 0,
+                            NBins);
+      Long64_t Passed = Flow.Candidates;
+      Hist->GetXaxis()->SetBinLabel(1, "Candidates");
+      Hist->SetBinContent(1, Flow.Candidates);
+      for (std::size_t i = 0; i < Order.size(); i++) {
+        Int_t k = Order[i];
+        Hist->GetXaxis()->SetBinLabel(i + 2, CutLabel(s, Program[k]).c_str());
+        Hist->SetBinContent(i + 2, Flow.Rejected[k]);
+        Passed -= Flow.Rejected[k];
+      }
+      Hist->GetXaxis()->SetBinLabel(NBins, "Passed");
+      Hist->SetBinContent(NBins, Passed);
+      List->Add(Hist);
+    }
+    return List;
+  }
+
+  // the same as json, for the summary of a run
+  nlohmann::json CutFlowJson(Int_t CutSet) const {
+    nlohmann::json Summary;
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      const auto &Program = fCutSets[CutSet].Programs[s];
+      const CutFlow &Flow = fCutSets[CutSet].Flow[s];
+      nlohmann::json Species;
+      Long64_t Passed = Flow.Candidates;
+      Species["Candidates"] = Flow.Candidates;
+      Species["Cuts"] = nlohmann::json::array();
+      for (auto k : fCutSets[CutSet].Order[s]) {
+        nlohmann::json Cut;
+        Cut["Cut"] = CutLabel(s, Program[k]);
+        Cut["Rejected"] = Flow.Rejected[k];
+        if (Flow.Sampled > 0) {
+          Cut["RejectedInSample"] =
+              static_cast<Double_t>(Flow.Failed[k]) / Flow.Sampled;
+        }
+        Species["Cuts"].push_back(Cut);
+        Passed -= Flow.Rejected[k];
+      }
+      Species["Passed"] = Passed;
+      Summary[kCutSpeciesName[s]] = Species;
+    }
+    return Summary;
+  }
+
+  // add the branches needed by the cuts
+  void AddBranches(std::set<std::string> &Branches) const {
+    Branches.insert("fIndexFemtoDreamCollisions");
+    Branches.insert("fPartType");
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      for (auto Variable : fVariables[s]) {
+        for (auto Branch : kCutVariableBranches[Variable]) {
+          Branches.insert(Branch);
+        }
+      }
+    }
+  }
+
+  // register the derived variables needed by the cuts
+  void AddVariables(FemtoDerived &Derived) const {
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      for (auto Variable : fVariables[s]) {
+        Derived.AddVariable(Variable);
+      }
+    }
+  }
+
+  // evaluate the event cuts of all cut sets for the collisions of a DF_
+  // directory
+  void SelectCollisions(const ParticleColumns &Parts,
+                        const CollisionColumns &Cols,
+                        const FemtoDerived &Derived,
+                        std::vector<CutMask> &Masks) {
+    Masks.assign(Cols.Entries, 0);
+    for (Long64_t Begin = 0; Begin < Cols.Entries; Begin += kBatchSize) {
+      Long64_t N = std::min(kBatchSize, Cols.Entries - Begin);
+      Evaluate(kCutEvent, Parts, Cols, Derived, Begin, N, nullptr,
+               Masks.data() + Begin);
+    }
+  }
+
+  // evaluate all cut sets for the particles [Begin, End)
+  void SelectParticles(const ParticleColumns &Parts,
+                       const CollisionColumns &Cols,
+                       const FemtoDerived &Derived,
+                       const std::vector<CutMask> &EventMasks, Long64_t Begin,
+                       Long64_t End, SelectionMasks &Masks) {
+    Long64_t N = End - Begin;
+    Masks.Event.assign(N, 0);
+    Masks.RawTrack.assign(N, 0);
+    Masks.RawV0.assign(N, 0);
+    Masks.Proton.assign(N, 0);
+    Masks.Deuteron.assign(N, 0);
+    Masks.Lambda.assign(N, 0);
+    fPosDaughter.assign(N, 0);
+    fNegDaughter.assign(N, 0);
+
+    for (Long64_t j = 0; j < N; j++) {
+      Int_t Collision = Parts.CollisionID[Begin + j];
+      if (Collision >= 0 && Collision < Cols.Entries) {
+        Masks.Event[j] = EventMasks[Collision];
+      }
+      UChar_t Type = Parts.PartType[Begin + j];
+      CutMask Track = Type == 0 ? ~CutMask(0) : 0;
+      // V0s without both daughters in the table are dropped
+      CutMask V0 = Type == 1 && Begin + j + 2 < Parts.Entries ? ~CutMask(0) : 0;
+      Masks.RawTrack[j] = Masks.Event[j] & Track;
+      Masks.RawV0[j] = Masks.Event[j] & V0;
+    }
+
+    // only tracks and V0s of selected collisions are candidates
+    Evaluate(kCutProton, Parts, Cols, Derived, Begin, N, Masks.RawTrack.data(),
+             Masks.Proton.data());
+    Evaluate(kCutDeuteron, Parts, Cols, Derived, Begin, N,
+             Masks.RawTrack.data(), Masks.Deuteron.data());
+    Evaluate(kCutLambda, Parts, Cols, Derived, Begin, N, Masks.RawV0.data(),
+             Masks.Lambda.data());
+
+    // the daughters are stored right after their Lambda
+    // rows are shifted so entry j of the daughter masks belongs to Lambda j
+    Evaluate(kCutPosDaughter, Parts, Cols, Derived, Begin + 1,
+             std::max<Long64_t>(std::min(N, Parts.Entries - Begin - 1), 0),
+             Masks.RawV0.data(), fPosDaughter.data());
+    Evaluate(kCutNegDaughter, Parts, Cols, Derived, Begin + 2,
+             std::max<Long64_t>(std::min(N, Parts.Entries - Begin - 2), 0),
+             Masks.RawV0.data(), fNegDaughter.data());
+
+    for (Long64_t j = 0; j < N; j++) {
+      Masks.Lambda[j] &= fPosDaughter[j] & fNegDaughter[j];
+    }
+  }
+
+private:
+  struct CutSet {
+    std::string Name;
+    std::vector<CutInstruction> Programs[kNCutSpecies];
+    // order the cuts are evaluated in, indices into Programs
+    std::vector<Int_t> Order[kNCutSpecies];
+    CutFlow Flow[kNCutSpecies];
+  };
+
+  static std::string CutSetName(const std::string &ConfigFile) {
+    std::string Name = ConfigFile.substr(ConfigFile.find_last_of('/') + 1);
+    return Name.substr(0, Name.find_last_of('.'));
+  }
+
+  // variables each species needs, computed once per batch for all cut sets
+  // the cuts start out in the order of the config
+  void Prepare() {
+    for (auto &Set : fCutSets) {
+      for (Int_t s = 0; s < kNCutSpecies; s++) {
+        Int_t NCuts = Set.Programs[s].size();
+        Set.Order[s].resize(NCuts);
+        for (Int_t k = 0; k < NCuts; k++) {
+          Set.Order[s][k] = k;
+        }
+        Set.Flow[s].Rejected.assign(NCuts, 0);
+        Set.Flow[s].Failed.assign(NCuts, 0);
+        for (const auto &Cut : Set.Programs[s]) {
+          AddVariable(s, Cut.Variable);
+          if (Cut.Gate != kGateNone) {
+            AddVariable(s, kVarP);
+          }
+        }
+      }
+    }
+  }
+
+  // cuts on the same variable which can be compared by their windows
+  static Bool_t SameCut(const CutInstruction &A, const CutInstruction &B) {
+    return A.Variable == B.Variable && A.Mode == B.Mode && A.Gate == B.Gate &&
+           (A.Gate == kGateNone || A.Threshold == B.Threshold);
+  }
+
+  static std::vector<CutInstruction>
+  Compile(Int_t Species, const nlohmann::json &Section, Double_t PTPC) {
+    std::vector<CutInstruction> Program;
+    for (auto &Item : Section.items()) {
+      Bool_t Known = false;
+      for (const auto &Rule : kCutRules) {
+        if (Item.key() != Rule.Key ||
+            (Rule.Species >= 0 && Rule.Species != Species)) {
+          continue;
+        }
+        Known = true;
+        Program.push_back({Rule.Variable, Item.value()["Min"].get<Double_t>(),
+                           Item.value()["Max"].get<Double_t>(), Rule.Mode,
+                           Rule.Gate, PTPC});
+      }
+      if (!Known) {
+        std::cout << "Unknown cut " << Item.key() << " for "
+                  << kCutSpeciesName[Species] << ". Skip..." << std::endl;
+      }
+    }
+    return Program;
+  }
+
+  void AddVariable(Int_t Species, CutVariable Variable) {
+    auto &Variables = fVariables[Species];
+    if (std::find(Variables.begin(), Variables.end(), Variable) ==
+        Variables.end()) {
+      Variables.push_back(Variable);
+    }
+  }
+
+  // keep the rows of [Rows, Rows + N) passing the cut at the front and return
+  // how many there are, used with the adaptive cut order
+  // Value and P hold the values of row Rows[i] at i
+  // branch free, the row is always written and only kept if it passes
+  static Long64_t Filter(const CutInstruction &Cut, const Double_t *Value,
+                         const Double_t *P, Int_t *Rows, Long64_t N) {
+    const UChar_t Outside = Cut.Mode == kCutOutside;
+    Long64_t Kept = 0;
+    if (Cut.Gate == kGateNone) {
+      for (Long64_t i = 0; i < N; i++) {
+        UChar_t Inside = (Cut.Min <= Value[i]) & (Value[i] <= Cut.Max);
+        Rows[Kept] = Rows[i];
+        Kept += Inside ^ Outside;
+      }
+    } else {
+      const UChar_t Below = Cut.Gate == kGateBelowPTPC;
+      for (Long64_t i = 0; i < N; i++) {
+        UChar_t Inside = (Cut.Min <= Value[i]) & (Value[i] <= Cut.Max);
+        UChar_t Applies = (P[i] <= Cut.Threshold) == Below;
+        Rows[Kept] = Rows[i];
+        Kept += (Inside ^ Outside) | !Applies;
+      }
+    }
+    return Kept;
+  }
+
+  // evaluate the cuts rejecting the most candidates per cost first
+  // a cut costs the load of its variable for the rows still passing, a gated
+  // cut loads the momentum as well and is counted twice as expensive
+  static void Reorder(CutSet &Set, Int_t Species) {
+    const auto &Program = Set.Programs[Species];
+    const auto &Failed = Set.Flow[Species].Failed;
+    auto Cost = [&Program](Int_t k) {
+      return Program[k].Gate == kGateNone ? 1 : 2;
+    };
+    std::stable_sort(Set.Order[Species].begin(), Set.Order[Species].end(),
+                     [&](Int_t a, Int_t b) {
+                       return Failed[a] * Cost(b) > Failed[b] * Cost(a);
+                     });
+  }
+
+  // check a cut on all rows of the batch, only rows with Pass set are
+  // candidates and Pass is cleared for the rows failing the cut
+  // returns how many candidates the cut rejected
+  // branch free, so the compiler can vectorize the loops
+  static Long64_t Dense(const CutInstruction &Cut,
+                        const Double_t *const *Values, UChar_t *Pass,
+                        Long64_t N) {
+    const Double_t *Value = Values[Cut.Variable];
+    const UChar_t Outside = Cut.Mode == kCutOutside;
+    Int_t Rejected = 0;
+    if (Cut.Gate == kGateNone) {
+      for (Long64_t j = 0; j < N; j++) {
+        UChar_t Inside = (Cut.Min <= Value[j]) & (Value[j] <= Cut.Max);
+        UChar_t Ok = Inside ^ Outside;
+        Rejected += Pass[j] & (Ok ^ 1);
+        Pass[j] &= Ok;
+      }
+    } else {
+      const Double_t *P = Values[kVarP];
+      const UChar_t Below = Cut.Gate == kGateBelowPTPC;
+      for (Long64_t j = 0; j < N; j++) {
+        UChar_t Inside = (Cut.Min <= Value[j]) & (Value[j] <= Cut.Max);
+        UChar_t Applies = (P[j] <= Cut.Threshold) == Below;
+        UChar_t Ok = (Inside ^ Outside) | !Applies;
+        Rejected += Pass[j] & (Ok ^ 1);
+        Pass[j] &= Ok;
+      }
+    }
+    return Rejected;
+  }
+
+  // run the programs of all cut sets for one species over the rows
+  // [Row, Row + N) and set the bits of the passing cut sets
+  // only rows whose bit is set in Candidates are checked, all rows if it is
+  // null
+  // with the adaptive cut order every cut only sees the rows which passed the
+  // cuts before it, otherwise every cut is checked on the whole batch
+  void Evaluate(Int_t Species, const ParticleColumns &Parts,
+                const CollisionColumns &Cols, const FemtoDerived &Derived,
+                Long64_t Row, Long64_t N, const CutMask *Candidates,
+                CutMask *Out) {
+    if (N <= 0) {
+      return;
+    }
+
+    // the dense loop needs every variable for the whole batch, with the
+    // adaptive cut order they are only loaded for the rows still passing
+    const Double_t *Values[kNCutVariables] = {};
+    if (!fAdaptive) {
+      for (auto Variable : fVariables[Species]) {
+        Values[Variable] = Derived.Values(Variable, Parts, Cols, Row, N,
+                                          fValues[Variable]);
+      }
+      fCandidate.resize(N);
+      fPass.resize(N);
+    } else {
+      fRows.resize(N);
+      fValues[0].resize(N);
+      fValues[1].resize(N);
+    }
+    for (std::size_t c = 0; c < fCutSets.size(); c++) {
+      CutSet &Set = fCutSets[c];
+      CutFlow &Flow = Set.Flow[Species];
+
+      if (!fAdaptive) {
+        UChar_t *Candidate = fCandidate.data();
+        UChar_t *Pass = fPass.data();
+        Long64_t NCandidates = 0;
+        for (Long64_t j = 0; j < N; j++) {
+          Candidate[j] = Candidates ? (Candidates[j] >> c) & 1 : 1;
+          NCandidates += Candidate[j];
+        }
+        std::copy(Candidate, Candidate + N, Pass);
+        Flow.Candidates += NCandidates;
+        Flow.Sampled += fSampling ? NCandidates : 0;
+
+        for (auto k : Set.Order[Species]) {
+          const CutInstruction &Cut = Set.Programs[Species][k];
+          Flow.Rejected[k] += Dense(Cut, Values, Pass, N);
+          // while sampling the cut is checked against all candidates as well
+          if (fSampling) {
+            fSample.assign(Candidate, Candidate + N);
+            Flow.Failed[k] += Dense(Cut, Values, fSample.data(), N);
+          }
+        }
+
+        for (Long64_t j = 0; j < N; j++) {
+          Out[j] |= static_cast<CutMask>(Pass[j]) << c;
+        }
+        continue;
+      }
+
+      Int_t *Rows = fRows.data();
+      Long64_t NRows = 0;
+      for (Long64_t j = 0; j < N; j++) {
+        Rows[NRows] = j;
+        NRows += Candidates ? (Candidates[j] >> c) & 1 : 1;
+      }
+      Flow.Candidates += NRows;
+
+      Double_t *Value = fValues[0].data();
+      Double_t *P = fValues[1].data();
+      for (auto k : Set.Order[Species]) {
+        const CutInstruction &Cut = Set.Programs[Species][k];
+        Derived.Gather(Cut.Variable, Parts, Cols, Row, Rows, NRows, Value);
+        if (Cut.Gate != kGateNone) {
+          Derived.Gather(kVarP, Parts, Cols, Row, Rows, NRows, P);
+        }
+        Long64_t Kept = Filter(Cut, Value, P, Rows, NRows);
+        Flow.Rejected[k] += NRows - Kept;
+        NRows = Kept;
+      }
+
+      for (Long64_t i = 0; i < NRows; i++) {
+        Out[Rows[i]] |= CutMask(1) << c;
+      }
+    }
+  }
+
+  std::vector<CutSet> fCutSets;
+  std::vector<CutVariable> fVariables[kNCutSpecies];
+  std::vector<Double_t> fValues[kNCutVariables];
+  std::vector<UChar_t> fCandidate, fPass, fSample;
+  std::vector<Int_t> fRows;
+  std::vector<CutMask> fPosDaughter, fNegDaughter;
+  Bool_t fSampling = false;
+  Bool_t fAdaptive = false;
+};
+
+#endif // FEMTOCUTS_H
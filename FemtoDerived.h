@@ -0,0 +1,418 @@
+/*
+ * File              : FemtoDerived.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTODERIVED_H
+#define FEMTODERIVED_H
+
+#include <RtypesCore.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "FemtoReader.h"
+
+// quantities a cut can be applied to or a histogram can be filled with
+enum CutVariable {
+  kVarVertexZ = 0,
+  kVarMultiplicity,
+  kVarCharge,
+  kVarPt,
+  kVarEta,
+  kVarP,
+  kVarDCAxy,
+  kVarDCAz,
+  kVarDCAPrimaryVertex,
+  kVarTPCClustersFound,
+  kVarTPCCrossedRows,
+  kVarTPCCrossedRowsOverFindable,
+  kVarTPCClustersShared,
+  kVarITSClusters,
+  kVarITSClustersIB,
+  kVarNSigmaTPCPr,
+  kVarNSigmaTPCDe,
+  kVarNSigmaTPCPi,
+  kVarNSigmaTPCEl,
+  kVarNSigmaTPCTOFPr,
+  kVarCosPA,
+  kVarTransRadius,
+  kVarDecayVertexDist,
+  kVarDaughterDCA,
+  kVarLambdaInvMass,
+  kVarK0InvMass,
+  kVarPhi,
+  kVarTPCClustersFindable,
+  kVarNSigmaTOFPr,
+  kVarNSigmaTOFDe,
+  kVarNSigmaTOFPi,
+  kVarZero,
+  kNCutVariables
+};
+
+// branches every variable is computed from
+static const std::vector<std::vector<const char *>> kCutVariableBranches = {
+    {"fPosZ"},
+    {"fMultV0M"},
+    {"fSign"},
+    {"fPt"},
+    {"fEta"},
+    {"fPt", "fEta"},
+    {"fDcaXY"},
+    {"fDcaZ"},
+    {"fDcaXY", "fDcaZ"},
+    {"fTPCNClsFound"},
+    {"fTPCNClsCrossedRows"},
+    {"fTPCNClsCrossedRows", "fTPCNClsFindable"},
+    {"fTPCNClsShared"},
+    {"fITSNCls"},
+    {"fITSNClsInnerBarrel"},
+    {"fTPCNSigmaStorePr"},
+    {"fTPCNSigmaStoreDe"},
+    {"fTPCNSigmaStorePi"},
+    {"fTPCNSigmaStoreEl"},
+    {"fTPCNSigmaStorePr", "fTOFNSigmaStorePr"},
+    {"fTempFitVar"},
+    {"fTransRadius"},
+    {"fIndexFemtoDreamCollisions", "fDecayVtxX", "fDecayVtxY", "fDecayVtxZ",
+     "fPosZ"},
+    {"fDaughDCA"},
+    {"fMLambda"},
+    {"fMKaon"},
+    {"fPhi"},
+    {"fTPCNClsFindable"},
+    {"fTOFNSigmaStorePr"},
+    {"fTOFNSigmaStoreDe"},
+    {"fTOFNSigmaStorePi"},
+    {},
+};
+
+// decode the n sigma values stored as int8 in the debug table
+inline Float_t ConvertBin(Char_t Input) {
+
+  typedef int8_t binned_t;
+  static constexpr int nbins = (1 << 8 * sizeof(binned_t)) - 2;
+  static constexpr binned_t overflowBin = nbins >> 1;
+  static constexpr binned_t underflowBin = -(nbins >> 1);
+  static constexpr float binned_max = 6.35;
+  static constexpr float binned_min = -6.35;
+  static constexpr float bin_width = (binned_max - binned_min) / nbins;
+
+  Int_t ConvInput = static_cast<Int_t>(Input);
+  Float_t Output = 0.;
+
+  if (ConvInput < underflowBin) {
+    Output = binned_min;
+  } else if (ConvInput > overflowBin) {
+    Output = binned_max;
+  } else if (ConvInput > 0) {
+    Output = (ConvInput - 0.5f) * bin_width;
+  } else {
+    Output = (ConvInput + 0.5f) * bin_width;
+  }
+
+  return Output;
+}
+
+// ConvertBin of all 256 possible bytes, indexed with the byte as unsigned
+inline const std::array<Float_t, 256> &NSigmaTable() {
+  static const std::array<Float_t, 256> Table = []() {
+    std::array<Float_t, 256> T;
+    for (Int_t Byte = 0; Byte < 256; Byte++) {
+      T[Byte] = ConvertBin(static_cast<Char_t>(Byte));
+    }
+    return T;
+  }();
+  return Table;
+}
+
+inline Float_t DecodeNSigma(Char_t Input) {
+  return NSigmaTable()[static_cast<UChar_t>(Input)];
+}
+
+// compute a variable for the rows RowOf(0), ..., RowOf(N - 1)
+// rows are particles, except for the event variables where they are collisions
+template <typename RowIndex>
+inline void FillCutVariableAt(CutVariable Variable,
+                              const ParticleColumns &Parts,
+                              const CollisionColumns &Cols, RowIndex RowOf,
+                              Long64_t N, Double_t *Out) {
+  switch (Variable) {
+  case kVarVertexZ:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Cols.PosZ[RowOf(j)];
+    }
+    break;
+  case kVarMultiplicity:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Cols.MultV0M[RowOf(j)];
+    }
+    break;
+  case kVarCharge:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.Sign[RowOf(j)];
+    }
+    break;
+  case kVarPt:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.Pt[RowOf(j)];
+    }
+    break;
+  case kVarEta:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.Eta[RowOf(j)];
+    }
+    break;
+  case kVarP:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.Pt[RowOf(j)] * std::cosh(Parts.Eta[RowOf(j)]);
+    }
+    break;
+  case kVarDCAxy:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.DcaXY[RowOf(j)];
+    }
+    break;
+  case kVarDCAz:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.DcaZ[RowOf(j)];
+    }
+    break;
+  case kVarDCAPrimaryVertex:
+    for (Long64_t j = 0; j < N; j++) {
+      Float_t XY = Parts.DcaXY[RowOf(j)], Z = Parts.DcaZ[RowOf(j)];
+      Out[j] = std::sqrt(XY * XY + Z * Z);
+    }
+    break;
+  case kVarTPCClustersFound:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TPCNClsFound[RowOf(j)];
+    }
+    break;
+  case kVarTPCCrossedRows:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TPCNClsCrossedRows[RowOf(j)];
+    }
+    break;
+  case kVarTPCCrossedRowsOverFindable:
+    // tracks without findable clusters are put at 3, like in the histograms
+    for (Long64_t j = 0; j < N; j++) {
+      UChar_t Findable = Parts.TPCNClsFindable[RowOf(j)];
+      Out[j] = Findable != 0 ? static_cast<Double_t>(
+                                   Parts.TPCNClsCrossedRows[RowOf(j)]) /
+                                   Findable
+                             : 3.;
+    }
+    break;
+  case kVarTPCClustersShared:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TPCNClsShared[RowOf(j)];
+    }
+    break;
+  case kVarITSClusters:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.ITSNCls[RowOf(j)];
+    }
+    break;
+  case kVarITSClustersIB:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.ITSNClsInnerBarrel[RowOf(j)];
+    }
+    break;
+  case kVarNSigmaTPCPr:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TPCNSigmaStorePr[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTPCDe:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TPCNSigmaStoreDe[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTPCPi:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TPCNSigmaStorePi[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTPCEl:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TPCNSigmaStoreEl[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTPCTOFPr:
+    for (Long64_t j = 0; j < N; j++) {
+      Double_t TPC = DecodeNSigma(Parts.TPCNSigmaStorePr[RowOf(j)]);
+      Double_t TOF = DecodeNSigma(Parts.TOFNSigmaStorePr[RowOf(j)]);
+      Out[j] = std::sqrt(TPC * TPC + TOF * TOF);
+    }
+    break;
+  case kVarCosPA:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TempFitVar[RowOf(j)];
+    }
+    break;
+  case kVarTransRadius:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TransRadius[RowOf(j)];
+    }
+    break;
+  case kVarDecayVertexDist:
+    // the primary vertex is approximated by (0, 0, z) of the collision
+    for (Long64_t j = 0; j < N; j++) {
+      Int_t Collision = Parts.CollisionID[RowOf(j)];
+      Float_t PosZ = Collision >= 0 && Collision < Cols.Entries
+                         ? Cols.PosZ[Collision]
+                         : 0.f;
+      Float_t X = Parts.DecayVtxX[RowOf(j)], Y = Parts.DecayVtxY[RowOf(j)],
+              Z = Parts.DecayVtxZ[RowOf(j)] - PosZ;
+      Out[j] = std::sqrt(X * X + Y * Y + Z * Z);
+    }
+    break;
+  case kVarDaughterDCA:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.DaughDCA[RowOf(j)];
+    }
+    break;
+  case kVarLambdaInvMass:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.MLambda[RowOf(j)];
+    }
+    break;
+  case kVarK0InvMass:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.MKaon[RowOf(j)];
+    }
+    break;
+  case kVarPhi:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.Phi[RowOf(j)];
+    }
+    break;
+  case kVarTPCClustersFindable:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = Parts.TPCNClsFindable[RowOf(j)];
+    }
+    break;
+  case kVarNSigmaTOFPr:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TOFNSigmaStorePr[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTOFDe:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TOFNSigmaStoreDe[RowOf(j)]);
+    }
+    break;
+  case kVarNSigmaTOFPi:
+    for (Long64_t j = 0; j < N; j++) {
+      Out[j] = DecodeNSigma(Parts.TOFNSigmaStorePi[RowOf(j)]);
+    }
+    break;
+  case kVarZero:
+    std::fill(Out, Out + N, 0.);
+    break;
+  default:
+    break;
+  }
+}
+
+// compute a variable for the rows [Row, Row + N)
+inline void FillCutVariable(CutVariable Variable, const ParticleColumns &Parts,
+                            const CollisionColumns &Cols, Long64_t Row,
+                            Long64_t N, Double_t *Out) {
+  auto RowOf = [Row](Long64_t j) { return Row + j; };
+  FillCutVariableAt(Variable, Parts, Cols, RowOf, N, Out);
+}
+
+// variables which are not just a copy of a column, but need some work to be
+// computed from one or more columns
+inline Bool_t IsDerived(CutVariable Variable) {
+  switch (Variable) {
+  case kVarP:
+  case kVarDCAPrimaryVertex:
+  case kVarTPCCrossedRowsOverFindable:
+  case kVarNSigmaTPCPr:
+  case kVarNSigmaTPCDe:
+  case kVarNSigmaTPCPi:
+  case kVarNSigmaTPCEl:
+  case kVarNSigmaTPCTOFPr:
+  case kVarDecayVertexDist:
+  case kVarNSigmaTOFPr:
+  case kVarNSigmaTOFDe:
+  case kVarNSigmaTOFPi:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// derived variables of all particles of a DF_ directory
+// they are computed once right after reading, so the cuts of all cut sets and
+// the histograms of all categories share them instead of recomputing them for
+// every batch, species and category
+class FemtoDerived {
+public:
+  // only registered variables are computed
+  void AddVariable(CutVariable Variable) {
+    if (IsDerived(Variable) && std::find(fVariables.begin(), fVariables.end(),
+                                         Variable) == fVariables.end()) {
+      fVariables.push_back(Variable);
+    }
+  }
+
+  void Compute(const ParticleColumns &Parts, const CollisionColumns &Cols) {
+    for (auto Variable : fVariables) {
+      fColumns[Variable].resize(Parts.Entries);
+      FillCutVariable(Variable, Parts, Cols, 0, Parts.Entries,
+                      fColumns[Variable].data());
+    }
+  }
+
+  // memory the precomputed columns take for a DF_ directory of N particles
+  std::size_t Bytes(Long64_t N) const {
+    return fVariables.size() * N * sizeof(Double_t);
+  }
+
+  // values of a variable for the rows [Row, Row + N)
+  // registered derived variables point into the precomputed columns, all
+  // others are converted into Scratch
+  const Double_t *Values(CutVariable Variable, const ParticleColumns &Parts,
+                         const CollisionColumns &Cols, Long64_t Row,
+                         Long64_t N, std::vector<Double_t> &Scratch) const {
+    if (IsDerived(Variable) &&
+        fColumns[Variable].size() == static_cast<std::size_t>(Parts.Entries)) {
+      return fColumns[Variable].data() + Row;
+    }
+    Scratch.resize(N);
+    FillCutVariable(Variable, Parts, Cols, Row, N, Scratch.data());
+    return Scratch.data();
+  }
+
+  // values of a variable for the rows Row + Rows[i], i < N, written to Out
+  // registered derived variables are copied from the precomputed columns
+  void Gather(CutVariable Variable, const ParticleColumns &Parts,
+              const CollisionColumns &Cols, Long64_t Row, const Int_t *Rows,
+              Long64_t N, Double_t *Out) const {
+    if (IsDerived(Variable) &&
+        fColumns[Variable].size() == static_cast<std::size_t>(Parts.Entries)) {
+      const Double_t *Column = fColumns[Variable].data() + Row;
+      for (Long64_t i = 0; i < N; i++) {
+        Out[i] = Column[Rows[i]];
+      }
+      return;
+    }
+    auto RowOf = [Row, Rows](Long64_t i) { return Row + Rows[i]; };
+    FillCutVariableAt(Variable, Parts, Cols, RowOf, N, Out);
+  }
+
+private:
+  std::vector<CutVariable> fVariables;
+  std::vector<Double_t> fColumns[kNCutVariables];
+};
+
+#endif // FEMTODERIVED_H
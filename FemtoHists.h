@@ -0,0 +1,540 @@
+/*
+ * File              : FemtoHists.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOHISTS_H
+#define FEMTOHISTS_H
+
+#include <RtypesCore.h>
+#include <TDirectory.h>
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TList.h>
+#include <algorithm>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FemtoCuts.h"
+#include "FemtoDerived.h"
+#include "FemtoReader.h"
+
+// histogram categories, the names are the TLists in the output file
+enum HistCategory {
+  kHistProton = 0,
+  kHistDeuteron,
+  kHistLambda,
+  kHistPosDaughter,
+  kHistNegDaughter,
+  kHistRawTrack,
+  kHistRawLambda,
+  kHistRawPosDaughter,
+  kHistRawNegDaughter,
+  kHistEvent,
+  kNHistCategories
+};
+
+// how a category is filled
+// Row is the offset to the row holding the particle, daughters are stored
+// right after their Lambda
+// NSigmaTPC and NSigmaTOF depend on the mass hypothesis of the category
+struct HistCategoryInfo {
+  const char *Name;
+  Int_t Row;
+  CutVariable NSigmaTPC, NSigmaTOF;
+};
+
+static const HistCategoryInfo kHistCategories[kNHistCategories] = {
+    {"Proton", 0, kVarNSigmaTPCPr, kVarNSigmaTOFPr},
+    {"Deuteron", 0, kVarNSigmaTPCDe, kVarNSigmaTOFDe},
+    {"Lambda", 0, kVarZero, kVarZero},
+    {"PosDaughter", 1, kVarNSigmaTPCPr, kVarNSigmaTOFPr},
+    {"NegDaughter", 2, kVarNSigmaTPCPi, kVarNSigmaTOFPi},
+    {"RawTrack", 0, kVarZero, kVarZero},
+    {"RawLambda", 0, kVarZero, kVarZero},
+    {"RawPosDaughter", 1, kVarNSigmaTPCPr, kVarNSigmaTOFPr},
+    {"RawNegDaughter", 2, kVarNSigmaTPCPi, kVarNSigmaTOFPi},
+    {"Event", 0, kVarZero, kVarZero},
+};
+
+// variable a key of the histogram config is filled with
+// kVarNSigmaTPCPr and kVarNSigmaTOFPr are placeholders for the nsigma of the
+// category
+struct HistKey {
+  const char *Key;
+  CutVariable Variable;
+};
+
+static const std::vector<HistKey> kHistKeys = {
+    {"VertexZ", kVarVertexZ},
+    {"Multiplicity", kVarMultiplicity},
+    {"Charge", kVarCharge},
+    {"Pt", kVarPt},
+    {"Eta", kVarEta},
+    {"Phi", kVarPhi},
+    {"P", kVarP},
+    {"DCAxy", kVarDCAxy},
+    {"DCAz", kVarDCAz},
+    {"DCAPrimaryVertex", kVarDCAPrimaryVertex},
+    {"DaughterDCA", kVarDaughterDCA},
+    {"TPCClustersFound", kVarTPCClustersFound},
+    {"TPCClustersFindable", kVarTPCClustersFindable},
+    {"TPCCrossedRows", kVarTPCCrossedRows},
+    {"TPCCrossedRowsOverFindable", kVarTPCCrossedRowsOverFindable},
+    {"TPCClustersShared", kVarTPCClustersShared},
+    {"ITSClusters", kVarITSClusters},
+    {"ITSClustersIB", kVarITSClustersIB},
+    {"NSigmaTPC", kVarNSigmaTPCPr},
+    {"NSigmaTOF", kVarNSigmaTOFPr},
+    {"CosPA", kVarCosPA},
+    {"TransRadius", kVarTransRadius},
+    {"DecayVertexDist", kVarDecayVertexDist},
+    {"K0InvMass", kVarK0InvMass},
+    {"LambdaInvMass", kVarLambdaInvMass},
+};
+
+// axes of the 2D histograms, X versus Y
+struct HistKey2D {
+  const char *Key;
+  CutVariable X, Y;
+};
+
+static const std::vector<HistKey2D> kHistKeys2D = {
+    {"DCAxyVsPt", kVarPt, kVarDCAxy},
+    {"DCAzVsPt", kVarPt, kVarDCAz},
+    {"NSigmaTPCvsP", kVarP, kVarNSigmaTPCPr},
+    {"NSigmaTOFvsP", kVarP, kVarNSigmaTOFPr},
+};
+
+// bin contents are kept as integer counts since all fills are unweighted
+// Dense uses 32 bit counters, Compact 16 bit counters with the rare overflows
+// kept aside and Sparse only stores bins which were filled
+enum HistStorage { kStorageDense = 0, kStorageCompact, kStorageSparse };
+
+// fixed size binning, bin numbers are computed exactly like TAxis::FindBin
+struct HistAxis {
+  Int_t Bins = 1;
+  Double_t Min = 0., Max = 1.;
+  CutVariable Variable = kVarZero;
+
+  Int_t FindBin(Double_t Value) const {
+    if (Value < Min) {
+      return 0;
+    }
+    if (!(Value < Max)) {
+      return Bins + 1;
+    }
+    return 1 + static_cast<Int_t>(Bins * (Value - Min) / (Max - Min));
+  }
+};
+
+// one histogram of one category for all cut sets
+// the cells of cut set c are stored at [c * Cells, (c + 1) * Cells) and the
+// cell numbering follows the global bin numbering of ROOT
+class FlatHist {
+public:
+  FlatHist(const std::string &Name, const HistAxis &X, const HistAxis &Y,
+           Bool_t Is2D, HistStorage Storage, Int_t NCutSets)
+      : fName(Name), fX(X), fY(Y), fIs2D(Is2D), fStorage(Storage) {
+    fCells = static_cast<Long64_t>(fX.Bins + 2) * (fIs2D ? fY.Bins + 2 : 1);
+    if (fStorage == kStorageDense) {
+      fDense.assign(fCells * NCutSets, 0);
+    } else if (fStorage == kStorageCompact) {
+      fCompact.assign(fCells * NCutSets, 0);
+    }
+  }
+
+  const HistAxis &X() const { return fX; }
+  const HistAxis &Y() const { return fY; }
+  Bool_t Is2D() const { return fIs2D; }
+
+  // cell numbers of a batch, Y is ignored for 1D histograms
+  void FindCells(const Double_t *XValues, const Double_t *YValues, Long64_t N,
+                 Long64_t *Cells) const {
+    for (Long64_t j = 0; j < N; j++) {
+      Cells[j] = fX.FindBin(XValues[j]);
+    }
+    if (fIs2D) {
+      const Long64_t Stride = fX.Bins + 2;
+      for (Long64_t j = 0; j < N; j++) {
+        Cells[j] += Stride * fY.FindBin(YValues[j]);
+      }
+    }
+  }
+
+  // fill entry j into every cut set which has its bit set in Masks[j]
+  void Fill(const Long64_t *Cells, const CutMask *Masks, Long64_t N) {
+    for (Long64_t j = 0; j < N; j++) {
+      for (CutMask Mask = Masks[j]; Mask; Mask &= Mask - 1) {
+        Increment(__builtin_ctzll(Mask) * fCells + Cells[j]);
+      }
+    }
+  }
+
+  // convert the cells of one cut set into a ROOT histogram
+  TH1 *ToROOT(Int_t CutSet) const {
+    TH1 *Hist;
+    if (fIs2D) {
+      Hist = new TH2F(fName.c_str(), fName.c_str(), fX.Bins, fX.Min, fX.Max,
+                      fY.Bins, fY.Min, fY.Max);
+    } else {
+      Hist = new TH1F(fName.c_str(), fName.c_str(), fX.Bins, fX.Min, fX.Max);
+    }
+
+    Double_t Entries = 0.;
+    const Long64_t First = CutSet * fCells;
+    if (fStorage == kStorageSparse) {
+      for (const auto &Cell : fSparse) {
+        if (Cell.first >= First && Cell.first < First + fCells) {
+          Hist->SetBinContent(Cell.first - First, Cell.second);
+          Entries += Cell.second;
+        }
+      }
+    } else {
+      for (Long64_t Cell = 0; Cell < fCells; Cell++) {
+        UInt_t Content = Get(First + Cell);
+        if (Content) {
+          Hist->SetBinContent(Cell, Content);
+          Entries += Content;
+        }
+      }
+    }
+    Hist->SetEntries(Entries);
+    return Hist;
+  }
+
+  // memory taken by the counters, filled sparse bins are not included
+  std::size_t Bytes() const {
+    return fDense.size() * sizeof(UInt_t) + fCompact.size() * sizeof(UShort_t);
+  }
+
+  // add the counts of another shard of the same histogram
+  void Merge(const FlatHist &Other) {
+    switch (fStorage) {
+    case kStorageDense:
+      for (std::size_t Index = 0; Index < fDense.size(); Index++) {
+        fDense[Index] += Other.fDense[Index];
+      }
+      break;
+    case kStorageCompact:
+      for (std::size_t Index = 0; Index < fCompact.size(); Index++) {
+        UInt_t Content = Get(Index) + Other.Get(Index);
+        fCompact[Index] = Content & 0xFFFF;
+        if (Content > 0xFFFF) {
+          fOverflow[Index] = Content & ~0xFFFFu;
+        }
+      }
+      break;
+    case kStorageSparse:
+      for (const auto &Cell : Other.fSparse) {
+        fSparse[Cell.first] += Cell.second;
+      }
+      break;
+    }
+  }
+
+private:
+  void Increment(Long64_t Index) {
+    switch (fStorage) {
+    case kStorageDense:
+      fDense[Index]++;
+      break;
+    case kStorageCompact:
+      // spill into the overflow map whenever the 16 bit counter wraps
+      if (++fCompact[Index] == 0) {
+        fOverflow[Index] += 1u << 16;
+      }
+      break;
+    case kStorageSparse:
+      fSparse[Index]++;
+      break;
+    }
+  }
+
+  UInt_t Get(Long64_t Index) const {
+    if (fStorage == kStorageDense) {
+      return fDense[Index];
+    }
+    UInt_t Content = fCompact[Index];
+    if (!fOverflow.empty()) {
+      auto Overflow = fOverflow.find(Index);
+      if (Overflow != fOverflow.end()) {
+        Content += Overflow->second;
+      }
+    }
+    return Content;
+  }
+
+  std::string fName;
+  HistAxis fX, fY;
+  Bool_t fIs2D;
+  HistStorage fStorage;
+  Long64_t fCells;
+  std::vector<UInt_t> fDense;
+  std::vector<UShort_t> fCompact;
+  std::unordered_map<Long64_t, UInt_t> fOverflow, fSparse;
+};
+
+class FemtoHists {
+public:
+  // histograms of all categories and cut sets as given in the histogram
+  // config
+  FemtoHists(const nlohmann::json &HistConfig, Int_t NCutSets)
+      : fNCutSets(NCutSets) {
+
+    for (Int_t c = 0; c < kNHistCategories; c++) {
+      const HistCategoryInfo &Category = kHistCategories[c];
+      const char *Section = c == kHistEvent ? "Event" : "Particle_1D";
+
+      for (auto &Item : HistConfig[Section].items()) {
+        HistAxis X;
+        if (!Axis(Item.key(), Item.value(), "", Category, X)) {
+          continue;
+        }
+        Add(c, Item.key(), X, HistAxis(), false, Item.value());
+      }
+
+      if (c == kHistEvent || !HistConfig.contains("Particle_2D")) {
+        continue;
+      }
+
+      for (auto &Item : HistConfig["Particle_2D"].items()) {
+        auto Key = std::find_if(
+            kHistKeys2D.begin(), kHistKeys2D.end(),
+            [&Item](const HistKey2D &K) { return Item.key() == K.Key; });
+        if (Key == kHistKeys2D.end()) {
+          std::cout << "Unknown histogram " << Item.key() << ". Skip..."
+                    << std::endl;
+          continue;
+        }
+        HistAxis X, Y;
+        Setup(X, Item.value(), "X", Resolve(Key->X, Category));
+        Setup(Y, Item.value(), "Y", Resolve(Key->Y, Category));
+        Add(c, Item.key(), X, Y, true, Item.value());
+      }
+    }
+  }
+
+  // add the branches needed to fill the histograms
+  void AddBranches(std::set<std::string> &Branches) const {
+    for (Int_t c = 0; c < kNHistCategories; c++) {
+      for (const auto &Hist : fHists[c]) {
+        for (auto Branch : kCutVariableBranches[Hist.X().Variable]) {
+          Branches.insert(Branch);
+        }
+        for (auto Branch : kCutVariableBranches[Hist.Y().Variable]) {
+          Branches.insert(Branch);
+        }
+      }
+    }
+  }
+
+  // register the derived variables needed by the histograms
+  void AddVariables(FemtoDerived &Derived) const {
+    for (Int_t c = 0; c < kNHistCategories; c++) {
+      for (const auto &Hist : fHists[c]) {
+        Derived.AddVariable(Hist.X().Variable);
+        Derived.AddVariable(Hist.Y().Variable);
+      }
+    }
+  }
+
+  // collisions are filled only once per cut set, reset for every DF_
+  // directory
+  void BeginDirectory(const CollisionColumns &Cols) {
+    fFilledCollisions.assign(Cols.Entries, 0);
+  }
+
+  // fill all histograms with the particles [Begin, End)
+  void FillBatch(const ParticleColumns &Parts, const CollisionColumns &Cols,
+                 const FemtoDerived &Derived, const SelectionMasks &Masks,
+                 Long64_t Begin, Long64_t End) {
+    Long64_t N = End - Begin;
+
+    // collisions are filled when their first selected particle shows up
+    fCollisionRows.clear();
+    fCollisionMasks.clear();
+    for (Long64_t j = 0; j < N; j++) {
+      if (!Masks.Event[j]) {
+        continue;
+      }
+      Int_t Collision = Parts.CollisionID[Begin + j];
+      CutMask New = Masks.Event[j] & ~fFilledCollisions[Collision];
+      if (New) {
+        fFilledCollisions[Collision] |= New;
+        fCollisionRows.push_back(Collision);
+        fCollisionMasks.push_back(New);
+      }
+    }
+    for (std::size_t k = 0; k < fCollisionRows.size(); k++) {
+      FillCategory(kHistEvent, Parts, Cols, Derived, fCollisionRows[k], 1,
+                   &fCollisionMasks[k]);
+    }
+
+    FillCategory(kHistRawTrack, Parts, Cols, Derived, Begin, N,
+                 Masks.RawTrack.data());
+    FillCategory(kHistRawLambda, Parts, Cols, Derived, Begin, N,
+                 Masks.RawV0.data());
+    FillCategory(kHistRawPosDaughter, Parts, Cols, Derived, Begin, N,
+                 Masks.RawV0.data());
+    FillCategory(kHistRawNegDaughter, Parts, Cols, Derived, Begin, N,
+                 Masks.RawV0.data());
+    FillCategory(kHistProton, Parts, Cols, Derived, Begin, N,
+                 Masks.Proton.data());
+    FillCategory(kHistDeuteron, Parts, Cols, Derived, Begin, N,
+                 Masks.Deuteron.data());
+    FillCategory(kHistLambda, Parts, Cols, Derived, Begin, N,
+                 Masks.Lambda.data());
+    FillCategory(kHistPosDaughter, Parts, Cols, Derived, Begin, N,
+                 Masks.Lambda.data());
+    FillCategory(kHistNegDaughter, Parts, Cols, Derived, Begin, N,
+                 Masks.Lambda.data());
+  }
+
+  // memory taken by the counters of all histograms
+  std::size_t Bytes() const {
+    std::size_t Sum = 0;
+    for (Int_t c = 0; c < kNHistCategories; c++) {
+      for (const auto &Hist : fHists[c]) {
+        Sum += Hist.Bytes();
+      }
+    }
+    return Sum;
+  }
+
+  // add the counts of another shard with the same configuration
+  void Merge(const FemtoHists &Other) {
+    for (Int_t c = 0; c < kNHistCategories; c++) {
+      for (std::size_t h = 0; h < fHists[c].size(); h++) {
+        fHists[c][h].Merge(Other.fHists[c][h]);
+      }
+    }
+  }
+
+  // write one TList per category for a cut set into the directory
+  // without Raw, only the categories of selected particles are written
+  void Write(TDirectory *Dir, Int_t CutSet, Bool_t Raw = true) const {
+    Dir->cd();
+    for (Int_t c = 0; c < (Raw ? kNHistCategories : kHistRawTrack); c++) {
+      TList *List = new TList();
+      for (const auto &Hist : fHists[c]) {
+        List->Add(Hist.ToROOT(CutSet));
+      }
+      List->Write(kHistCategories[c].Name, TObject::kSingleKey);
+    }
+  }
+
+private:
+  // resolve the nsigma placeholders to the mass hypothesis of the category
+  static CutVariable Resolve(CutVariable Variable,
+                             const HistCategoryInfo &Category) {
+    if (Variable == kVarNSigmaTPCPr) {
+      return Category.NSigmaTPC;
+    }
+    if (Variable == kVarNSigmaTOFPr) {
+      return Category.NSigmaTOF;
+    }
+    return Variable;
+  }
+
+  static void Setup(HistAxis &A, const nlohmann::json &Config,
+                    const std::string &Prefix, CutVariable Variable) {
+    A.Bins = Config[Prefix + "Bins"].get<Int_t>();
+    A.Min = Config[Prefix + "RangeMin"].get<Double_t>();
+    A.Max = Config[Prefix + "RangeMax"].get<Double_t>();
+    A.Variable = Variable;
+  }
+
+  static Bool_t Axis(const std::string &Key, const nlohmann::json &Config,
+                     const std::string &Prefix,
+                     const HistCategoryInfo &Category, HistAxis &A) {
+    auto K = std::find_if(kHistKeys.begin(), kHistKeys.end(),
+                          [&Key](const HistKey &H) { return Key == H.Key; });
+    if (K == kHistKeys.end()) {
+      std::cout << "Unknown histogram " << Key << ". Skip..." << std::endl;
+      return false;
+    }
+    Setup(A, Config, Prefix, Resolve(K->Variable, Category));
+    return true;
+  }
+
+  void Add(Int_t Category, const std::string &Key, const HistAxis &X,
+           const HistAxis &Y, Bool_t Is2D, const nlohmann::json &Config) {
+    HistStorage Storage = kStorageDense;
+    std::string Mode = Config.value("Storage", "Dense");
+    if (Mode == "Compact") {
+      Storage = kStorageCompact;
+    } else if (Mode == "Sparse") {
+      Storage = kStorageSparse;
+    } else if (Mode != "Dense") {
+      std::cout << "Unknown storage " << Mode << " for " << Key
+                << ". Use Dense..." << std::endl;
+    }
+    fHists[Category].emplace_back(
+        std::string(kHistCategories[Category].Name) + "_" + Key, X, Y, Is2D,
+        Storage, fNCutSets);
+  }
+
+  // fill the rows [Row, Row + N) of a category
+  void FillCategory(Int_t Category, const ParticleColumns &Parts,
+                    const CollisionColumns &Cols, const FemtoDerived &Derived,
+                    Long64_t Row, Long64_t N, const CutMask *Masks) {
+
+    // nothing selected in this batch
+    if (std::none_of(Masks, Masks + N, [](CutMask M) { return M != 0; })) {
+      return;
+    }
+
+    // daughter rows past the end of the table are never selected
+    if (Category != kHistEvent) {
+      Row += kHistCategories[Category].Row;
+      N = std::min(N, Parts.Entries - Row);
+      if (N <= 0) {
+        return;
+      }
+    }
+
+    // every variable is looked up once for all histograms of the category
+    fComputed.assign(kNCutVariables, nullptr);
+    fCells.resize(N);
+
+    for (auto &Hist : fHists[Category]) {
+      const Double_t *X =
+          Values(Hist.X().Variable, Parts, Cols, Derived, Row, N);
+      const Double_t *Y =
+          Hist.Is2D() ? Values(Hist.Y().Variable, Parts, Cols, Derived, Row, N)
+                      : X;
+      Hist.FindCells(X, Y, N, fCells.data());
+      Hist.Fill(fCells.data(), Masks, N);
+    }
+  }
+
+  const Double_t *Values(CutVariable Variable, const ParticleColumns &Parts,
+                         const CollisionColumns &Cols,
+                         const FemtoDerived &Derived, Long64_t Row,
+                         Long64_t N) {
+    if (!fComputed[Variable]) {
+      fComputed[Variable] =
+          Derived.Values(Variable, Parts, Cols, Row, N, fValues[Variable]);
+    }
+    return fComputed[Variable];
+  }
+
+  Int_t fNCutSets;
+  std::vector<FlatHist> fHists[kNHistCategories];
+  std::vector<CutMask> fFilledCollisions;
+  std::vector<Long64_t> fCollisionRows;
+  std::vector<CutMask> fCollisionMasks;
+  std::vector<const Double_t *> fComputed;
+  std::vector<Double_t> fValues[kNCutVariables];
+  std::vector<Long64_t> fCells;
+};
+
+#endif // FEMTOHISTS_H
@@ -0,0 +1,546 @@
+/*
+ * File              : FemtoPairs.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOPAIRS_H
+#define FEMTOPAIRS_H
+
+#include <RtypesCore.h>
+#include <TH1F.h>
+#include <TList.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "FemtoReader.h"
+
+// particle species which can be paired
+enum PairSpecies { kPairProton = 0, kPairDeuteron, kPairLambda, kNPairSpecies };
+
+static const char *kPairSpeciesName[kNPairSpecies] = {"Proton", "Deuteron",
+                                                      "Lambda"};
+static constexpr Double_t kPairSpeciesMass[kNPairSpecies] = {
+    0.938272088, 1.875612928, 1.115683};
+
+// four momenta of particles as contiguous arrays
+struct PairKinematics {
+  std::vector<Float_t> Px, Py, Pz, E;
+
+  void Resize(std::size_t N) {
+    Px.resize(N);
+    Py.resize(N);
+    Pz.resize(N);
+    E.resize(N);
+  }
+
+  void Clear() { Resize(0); }
+
+  void Set(std::size_t Index, Float_t Pt, Float_t Eta, Float_t Phi,
+           Double_t Mass) {
+    Px[Index] = Pt * std::cos(Phi);
+    Py[Index] = Pt * std::sin(Phi);
+    Pz[Index] = Pt * std::sinh(Eta);
+    E[Index] = std::sqrt(Px[Index] * Px[Index] + Py[Index] * Py[Index] +
+                         Pz[Index] * Pz[Index] + Mass * Mass);
+  }
+
+  void Copy(std::size_t Index, const PairKinematics &Source,
+            std::size_t SourceIndex) {
+    Px[Index] = Source.Px[SourceIndex];
+    Py[Index] = Source.Py[SourceIndex];
+    Pz[Index] = Source.Pz[SourceIndex];
+    E[Index] = Source.E[SourceIndex];
+  }
+};
+
+// uniformly binned k* distribution with flat storage
+// bin 0 is the underflow and bin Bins+1 the overflow, like in ROOT
+struct KstarHist {
+  Int_t Bins = 0;
+  Double_t Min = 0., Max = 0., InvWidth = 0.;
+  std::vector<Double_t> Counts;
+
+  void Setup(Int_t NBins, Double_t RangeMin, Double_t RangeMax) {
+    Bins = NBins;
+    Min = RangeMin;
+    Max = RangeMax;
+    InvWidth = Bins / (Max - Min);
+    Counts.assign(Bins + 2, 0.);
+  }
+
+  void Fill(Double_t Kstar) {
+    Int_t Bin;
+    if (Kstar < Min) {
+      Bin = 0;
+    } else if (Kstar >= Max) {
+      Bin = Bins + 1;
+    } else {
+      Bin = 1 + static_cast<Int_t>((Kstar - Min) * InvWidth);
+    }
+    Counts[Bin] += 1.;
+  }
+
+  void FillN(const Double_t *Kstar, Int_t N) {
+    for (Int_t j = 0; j < N; j++) {
+      Fill(Kstar[j]);
+    }
+  }
+
+  void Merge(const KstarHist &Other) {
+    for (std::size_t Bin = 0; Bin < Counts.size(); Bin++) {
+      Counts[Bin] += Other.Counts[Bin];
+    }
+  }
+
+  TH1F *ToTH1F(const std::string &Name) const {
+    TH1F *Hist = new TH1F(Name.c_str(), Name.c_str(), Bins, Min, Max);
+    Double_t Entries = 0.;
+    for (Int_t Bin = 0; Bin < Bins + 2; Bin++) {
+      Hist->SetBinContent(Bin, Counts[Bin]);
+      Entries += Counts[Bin];
+    }
+    Hist->SetEntries(Entries);
+    return Hist;
+  }
+};
+
+// k* of particle a with the particles [0, N) of b, written to KstarOut
+// with D = E1*E2 - p1.p2 the invariant mass squared is s = m1^2 + m2^2 + 2D
+// and k*^2 = (D^2 - m1^2 m2^2) / s, which avoids any boost and lets the
+// compiler vectorize the loop
+inline void ComputeKstar(Double_t Px1, Double_t Py1, Double_t Pz1, Double_t E1,
+                         const Float_t *Px2, const Float_t *Py2,
+                         const Float_t *Pz2, const Float_t *E2, Int_t N,
+                         Double_t MassSqSum, Double_t MassProdSq,
+                         Double_t *KstarOut) {
+  for (Int_t j = 0; j < N; j++) {
+    Double_t D = E1 * E2[j] - Px1 * Px2[j] - Py1 * Py2[j] - Pz1 * Pz2[j];
+    Double_t KstarSq = (D * D - MassProdSq) / (MassSqSum + 2. * D);
+    KstarOut[j] = std::sqrt(std::max(KstarSq, 0.));
+  }
+}
+
+// ring buffer of the last Depth events of one species in one mixing bin
+// every event owns Capacity consecutive slots of the kinematic arrays
+struct MixingPool {
+  Int_t Depth = 0, Capacity = 0;
+  Int_t Next = 0, Filled = 0;
+  std::vector<Int_t> Counts;
+  PairKinematics Particles;
+
+  void Setup(Int_t PoolDepth, Int_t PoolCapacity) {
+    Depth = PoolDepth;
+    Capacity = PoolCapacity;
+    Counts.assign(Depth, 0);
+    Particles.Resize(static_cast<std::size_t>(Depth) * Capacity);
+  }
+
+  // overwrite the oldest event with particles [Begin, Begin + N) of Source
+  // particles beyond the capacity of an event are not kept for mixing
+  void Push(const PairKinematics &Source, Int_t Begin, Int_t N) {
+    N = std::min(N, Capacity);
+    std::size_t Offset = static_cast<std::size_t>(Next) * Capacity;
+    for (Int_t i = 0; i < N; i++) {
+      Particles.Copy(Offset + i, Source, Begin + i);
+    }
+    Counts[Next] = N;
+    Next = (Next + 1) % Depth;
+    Filled = std::min(Filled + 1, Depth);
+  }
+};
+
+// selected particles of the collisions of a DF_ directory which fall into a
+// mixing bin, event e holds particles [Begin[s][e], Begin[s][e] + N[s][e]) of
+// every species s
+// they are kept until all directories are processed and then mixed in the
+// order of the directories, so the mixed events do not depend on the threads
+struct MixingEvents {
+  std::vector<Int_t> Bin;
+  std::vector<Int_t> Begin[kNPairSpecies], N[kNPairSpecies];
+  PairKinematics Particles[kNPairSpecies];
+
+  // append an event with particles [First[s], First[s] + Count[s]) of Source
+  void Add(Int_t EventBin, const PairKinematics *Source, const Int_t *First,
+           const Int_t *Count) {
+    Bin.push_back(EventBin);
+    for (Int_t s = 0; s < kNPairSpecies; s++) {
+      std::size_t Offset = Particles[s].Px.size();
+      Begin[s].push_back(Offset);
+      N[s].push_back(Count[s]);
+      Particles[s].Resize(Offset + Count[s]);
+      for (Int_t i = 0; i < Count[s]; i++) {
+        Particles[s].Copy(Offset + i, Source[s], First[s] + i);
+      }
+    }
+  }
+
+  void Clear() {
+    Bin.clear();
+    for (Int_t s = 0; s < kNPairSpecies; s++) {
+      Begin[s].clear();
+      N[s].clear();
+      Particles[s].Clear();
+      Particles[s].Px.shrink_to_fit();
+      Particles[s].Py.shrink_to_fit();
+      Particles[s].Pz.shrink_to_fit();
+      Particles[s].E.shrink_to_fit();
+    }
+  }
+};
+
+class FemtoPairs {
+public:
+  // configured with the "Pairs" section of the histogram config
+  // all keys are optional, an empty section builds no pairs and mixes nothing
+  explicit FemtoPairs(const nlohmann::json &Config) {
+
+    fDepth = Config.value("MixingDepth", 0);
+    fCapacity = Config.value("MaxParticlesPerEvent", 0);
+    fVertexZBins = Config.value("VertexZBins", std::vector<Double_t>());
+    fMultBins = Config.value("MultiplicityBins", std::vector<Double_t>());
+
+    const nlohmann::json Combinations =
+        Config.value("Combinations", nlohmann::json::array());
+    for (auto &Combination : Combinations) {
+      Int_t A = SpeciesIndex(Combination.at(0).get<std::string>());
+      Int_t B = SpeciesIndex(Combination.at(1).get<std::string>());
+      if (A < 0 || B < 0) {
+        std::cout << "Unknown pair " << Combination.dump() << ". Skip..."
+                  << std::endl;
+        continue;
+      }
+
+      Pair P;
+      P.A = A;
+      P.B = B;
+      P.MassSqSum = kPairSpeciesMass[A] * kPairSpeciesMass[A] +
+                    kPairSpeciesMass[B] * kPairSpeciesMass[B];
+      P.MassProdSq = kPairSpeciesMass[A] * kPairSpeciesMass[A] *
+                     kPairSpeciesMass[B] * kPairSpeciesMass[B];
+      P.SameEvent.Setup(Config.at("Kstar").at("Bins").get<Int_t>(),
+                        Config.at("Kstar").at("RangeMin").get<Double_t>(),
+                        Config.at("Kstar").at("RangeMax").get<Double_t>());
+      P.MixedEvent = P.SameEvent;
+      fPairs.push_back(P);
+
+      fUsed[A] = true;
+      fUsed[B] = true;
+    }
+
+    // a mixing depth of 0 switches off event mixing
+    Int_t NBins = fDepth > 0 && fCapacity > 0 ? NMixingBins() : 0;
+    fPools.resize(static_cast<std::size_t>(NBins) * kNPairSpecies);
+    for (auto &Pool : fPools) {
+      Pool.Setup(fDepth, fCapacity);
+    }
+  }
+
+  // is the species part of any configured pair
+  Bool_t Used(Int_t Species) const { return fUsed[Species]; }
+
+  // add the branches needed to build the pairs and to find the mixing bin of
+  // a collision
+  void AddBranches(std::set<std::string> &Branches) const {
+    if (!fPairs.empty()) {
+      Branches.insert({"fIndexFemtoDreamCollisions", "fPt", "fEta", "fPhi"});
+    }
+    if (!fPools.empty()) {
+      Branches.insert({"fPosZ", "fMultV0M"});
+    }
+  }
+
+  // buffer a selected particle of the current DF_ directory
+  // Row is its row in the particle table, which links a Lambda to its
+  // daughters in the two rows after it
+  void AddParticle(Int_t Species, Long64_t Row, Int_t CollisionID, Float_t Pt,
+                   Float_t Eta, Float_t Phi) {
+    if (!fUsed[Species] || CollisionID < 0) {
+      return;
+    }
+    Buffer &B = fBuffers[Species];
+    std::size_t Index = B.CollisionID.size();
+    B.Row.push_back(Row);
+    B.CollisionID.push_back(CollisionID);
+    B.Particles.Resize(Index + 1);
+    B.Particles.Set(Index, Pt, Eta, Phi, kPairSpeciesMass[Species]);
+  }
+
+  // build all same event pairs of the buffered particles and keep the events
+  // falling into a mixing bin in Events, they are mixed later by Mix
+  // collisions are processed in the order of their index, so the result does
+  // not depend on the order particles are stored in the tree
+  void ProcessDirectory(const CollisionColumns &Cols, MixingEvents &Events) {
+
+    for (Int_t s = 0; s < kNPairSpecies; s++) {
+      SortBuffer(s);
+    }
+
+    Int_t Begin[kNPairSpecies] = {0};
+    Int_t N[kNPairSpecies] = {0};
+
+    for (Long64_t Collision = 0; Collision < Cols.Entries; Collision++) {
+
+      Bool_t Empty = true;
+      for (Int_t s = 0; s < kNPairSpecies; s++) {
+        const Buffer &B = fBuffers[s];
+        Begin[s] += N[s];
+        N[s] = 0;
+        while (Begin[s] + N[s] < static_cast<Int_t>(B.CollisionID.size()) &&
+               B.CollisionID[Begin[s] + N[s]] == Collision) {
+          N[s]++;
+        }
+        Empty = Empty && N[s] == 0;
+      }
+
+      if (Empty) {
+        continue;
+      }
+
+      Int_t Bin = fPools.empty() ? -1
+                                 : MixingBin(Cols.PosZ[Collision],
+                                             Cols.MultV0M[Collision]);
+
+      for (auto &P : fPairs) {
+        SameEvent(P, Begin, N);
+      }
+
+      if (Bin >= 0) {
+        Events.Add(Bin, fSorted, Begin, N);
+      }
+    }
+
+    for (auto &B : fBuffers) {
+      B.Row.clear();
+      B.CollisionID.clear();
+      B.Particles.Clear();
+    }
+  }
+
+  // memory taken by the k* histograms and the mixing pools
+  std::size_t Bytes() const {
+    std::size_t Sum = 0;
+    for (const auto &P : fPairs) {
+      Sum += (P.SameEvent.Counts.size() + P.MixedEvent.Counts.size()) *
+             sizeof(Double_t);
+    }
+    for (const auto &Pool : fPools) {
+      Sum += Pool.Counts.size() * sizeof(Int_t) +
+             4 * Pool.Particles.Px.size() * sizeof(Float_t);
+    }
+    return Sum;
+  }
+
+  // mix the events of a DF_ directory with the events in the pools of their
+  // bin and push them into the pools afterwards
+  // called for all directories in a fixed order, the pools are kept from one
+  // directory to the next
+  void Mix(const MixingEvents &Events) {
+    for (std::size_t e = 0; e < Events.Bin.size(); e++) {
+      Int_t Begin[kNPairSpecies], N[kNPairSpecies];
+      for (Int_t s = 0; s < kNPairSpecies; s++) {
+        Begin[s] = Events.Begin[s][e];
+        N[s] = Events.N[s][e];
+      }
+      for (auto &P : fPairs) {
+        MixedEvent(P, Events.Particles, Events.Bin[e], Begin, N);
+      }
+      for (Int_t s = 0; s < kNPairSpecies; s++) {
+        if (N[s] > 0) {
+          Pool(Events.Bin[e], s).Push(Events.Particles[s], Begin[s], N[s]);
+        }
+      }
+    }
+  }
+
+  // add the k* distributions of another shard with the same configuration
+  void Merge(const FemtoPairs &Other) {
+    for (std::size_t p = 0; p < fPairs.size(); p++) {
+      fPairs[p].SameEvent.Merge(Other.fPairs[p].SameEvent);
+      fPairs[p].MixedEvent.Merge(Other.fPairs[p].MixedEvent);
+    }
+  }
+
+  // same and mixed event k* distributions of all configured pairs
+  TList *GetList() const {
+    TList *List = new TList();
+    for (auto &P : fPairs) {
+      std::string Name =
+          std::string(kPairSpeciesName[P.A]) + "_" + kPairSpeciesName[P.B];
+      List->Add(P.SameEvent.ToTH1F("SE_" + Name));
+      List->Add(P.MixedEvent.ToTH1F("ME_" + Name));
+    }
+    return List;
+  }
+
+private:
+  struct Pair {
+    Int_t A, B;
+    Double_t MassSqSum, MassProdSq;
+    KstarHist SameEvent, MixedEvent;
+  };
+
+  struct Buffer {
+    std::vector<Long64_t> Row;
+    std::vector<Int_t> CollisionID;
+    PairKinematics Particles;
+  };
+
+  static Int_t SpeciesIndex(const std::string &Name) {
+    for (Int_t s = 0; s < kNPairSpecies; s++) {
+      if (Name == kPairSpeciesName[s]) {
+        return s;
+      }
+    }
+    return -1;
+  }
+
+  static Int_t FindBin(const std::vector<Double_t> &Edges, Double_t Value) {
+    if (Edges.size() < 2 || Value < Edges.front() || Value >= Edges.back()) {
+      return -1;
+    }
+    return std::upper_bound(Edges.begin(), Edges.end(), Value) -
+           Edges.begin() - 1;
+  }
+
+  Int_t NMixingBins() const {
+    return std::max<Int_t>(fVertexZBins.size() - 1, 0) *
+           std::max<Int_t>(fMultBins.size() - 1, 0);
+  }
+
+  Int_t MixingBin(Double_t VertexZ, Double_t Mult) const {
+    Int_t BinZ = FindBin(fVertexZBins, VertexZ);
+    Int_t BinMult = FindBin(fMultBins, Mult);
+    if (BinZ < 0 || BinMult < 0) {
+      return -1;
+    }
+    return BinZ * (fMultBins.size() - 1) + BinMult;
+  }
+
+  MixingPool &Pool(Int_t Bin, Int_t Species) {
+    return fPools[static_cast<std::size_t>(Bin) * kNPairSpecies + Species];
+  }
+
+  // stable sort of the buffered particles of one species by collision
+  void SortBuffer(Int_t Species) {
+    Buffer &B = fBuffers[Species];
+    std::vector<Int_t> Order(B.CollisionID.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::stable_sort(Order.begin(), Order.end(), [&B](Int_t i, Int_t j) {
+      return B.CollisionID[i] < B.CollisionID[j];
+    });
+
+    PairKinematics &Sorted = fSorted[Species];
+    Sorted.Resize(Order.size());
+    std::vector<Long64_t> Row(Order.size());
+    std::vector<Int_t> CollisionID(Order.size());
+    for (std::size_t i = 0; i < Order.size(); i++) {
+      Sorted.Copy(i, B.Particles, Order[i]);
+      Row[i] = B.Row[Order[i]];
+      CollisionID[i] = B.CollisionID[Order[i]];
+    }
+    B.Row.swap(Row);
+    B.CollisionID.swap(CollisionID);
+  }
+
+  // k* of particle i of A with particles [First, First + N) of B
+  void FillPairs(Pair &P, const PairKinematics &A, Int_t i,
+                 const PairKinematics &B, std::size_t First, Int_t N,
+                 KstarHist &Hist) {
+    if (N <= 0) {
+      return;
+    }
+    if (static_cast<Int_t>(fScratch.size()) < N) {
+      fScratch.resize(N);
+    }
+    ComputeKstar(A.Px[i], A.Py[i], A.Pz[i], A.E[i], B.Px.data() + First,
+                 B.Py.data() + First, B.Pz.data() + First, B.E.data() + First,
+                 N, P.MassSqSum, P.MassProdSq, fScratch.data());
+    Hist.FillN(fScratch.data(), N);
+  }
+
+  void SameEvent(Pair &P, const Int_t *Begin, const Int_t *N) {
+    const PairKinematics &A = fSorted[P.A];
+    const PairKinematics &B = fSorted[P.B];
+    if (P.A != P.B && (P.A == kPairLambda || P.B == kPairLambda)) {
+      CleanSameEvent(P, Begin, N);
+      return;
+    }
+    for (Int_t i = Begin[P.A]; i < Begin[P.A] + N[P.A]; i++) {
+      // identical particles are only paired once
+      Int_t First = P.A == P.B ? i + 1 : Begin[P.B];
+      FillPairs(P, A, i, B, First, Begin[P.B] + N[P.B] - First, P.SameEvent);
+    }
+  }
+
+  // track-Lambda pairs of the same event, a track which is stored as one of
+  // the daughters of the Lambda, in the two rows after it, is not paired with
+  // it
+  void CleanSameEvent(Pair &P, const Int_t *Begin, const Int_t *N) {
+    const PairKinematics &A = fSorted[P.A];
+    const PairKinematics &B = fSorted[P.B];
+    const std::vector<Long64_t> &RowA = fBuffers[P.A].Row;
+    const std::vector<Long64_t> &RowB = fBuffers[P.B].Row;
+    Int_t NB = N[P.B];
+    if (NB <= 0) {
+      return;
+    }
+    if (static_cast<Int_t>(fScratch.size()) < NB) {
+      fScratch.resize(NB);
+    }
+    for (Int_t i = Begin[P.A]; i < Begin[P.A] + N[P.A]; i++) {
+      ComputeKstar(A.Px[i], A.Py[i], A.Pz[i], A.E[i], B.Px.data() + Begin[P.B],
+                   B.Py.data() + Begin[P.B], B.Pz.data() + Begin[P.B],
+                   B.E.data() + Begin[P.B], NB, P.MassSqSum, P.MassProdSq,
+                   fScratch.data());
+      for (Int_t j = 0; j < NB; j++) {
+        Long64_t Track = P.A == kPairLambda ? RowB[Begin[P.B] + j] : RowA[i];
+        Long64_t Lambda = P.A == kPairLambda ? RowA[i] : RowB[Begin[P.B] + j];
+        if (Track == Lambda + 1 || Track == Lambda + 2) {
+          continue;
+        }
+        P.SameEvent.Fill(fScratch[j]);
+      }
+    }
+  }
+
+  // pair the current event with the events in the pool of the same bin
+  // for non-identical pairs both orderings are mixed
+  void MixedEvent(Pair &P, const PairKinematics *Current, Int_t Bin,
+                  const Int_t *Begin, const Int_t *N) {
+    MixWithPool(P, Current[P.A], Begin[P.A], N[P.A], Pool(Bin, P.B));
+    if (P.A != P.B) {
+      MixWithPool(P, Current[P.B], Begin[P.B], N[P.B], Pool(Bin, P.A));
+    }
+  }
+
+  void MixWithPool(Pair &P, const PairKinematics &Current, Int_t Begin,
+                   Int_t N, const MixingPool &Pool) {
+    for (Int_t Slot = 0; Slot < Pool.Filled; Slot++) {
+      std::size_t Offset = static_cast<std::size_t>(Slot) * Pool.Capacity;
+      for (Int_t i = Begin; i < Begin + N; i++) {
+        FillPairs(P, Current, i, Pool.Particles, Offset, Pool.Counts[Slot],
+                  P.MixedEvent);
+      }
+    }
+  }
+
+  Int_t fDepth = 0, fCapacity = 0;
+  std::vector<Double_t> fVertexZBins, fMultBins;
+  std::vector<Pair> fPairs;
+  Bool_t fUsed[kNPairSpecies] = {false};
+  Buffer fBuffers[kNPairSpecies];
+  PairKinematics fSorted[kNPairSpecies];
+  std::vector<MixingPool> fPools;
+  std::vector<Double_t> fScratch;
+};
+
+#endif // FEMTOPAIRS_H
@@ -0,0 +1,103 @@
+/*
+ * File              : FemtoPool.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOPOOL_H
+#define FEMTOPOOL_H
+
+#include <RtypesCore.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// thread pool running a fixed set of work items
+// every worker starts on its own contiguous block of items and steals from the
+// back of the other queues once its own queue is empty, so one slow item does
+// not leave the other threads idle
+class FemtoPool {
+public:
+  explicit FemtoPool(Int_t NThreads)
+      : fNThreads(std::max<Int_t>(NThreads, 1)), fQueues(fNThreads) {}
+
+  Int_t NThreads() const { return fNThreads; }
+
+  // call Work(Thread, Item) for all items [0, NItems)
+  // Thread is the index of the worker in [0, NThreads) running the item
+  void Run(std::size_t NItems,
+           const std::function<void(Int_t, std::size_t)> &Work) {
+
+    for (Int_t t = 0; t < fNThreads; t++) {
+      std::size_t First = NItems * t / fNThreads;
+      std::size_t Last = NItems * (t + 1) / fNThreads;
+      fQueues[t].Items.clear();
+      for (std::size_t Item = First; Item < Last; Item++) {
+        fQueues[t].Items.push_back(Item);
+      }
+    }
+
+    if (fNThreads == 1) {
+      Worker(0, Work);
+      return;
+    }
+
+    std::vector<std::thread> Threads;
+    for (Int_t t = 0; t < fNThreads; t++) {
+      Threads.emplace_back([this, t, &Work]() { Worker(t, Work); });
+    }
+    for (auto &Thread : Threads) {
+      Thread.join();
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex Lock;
+    std::deque<std::size_t> Items;
+  };
+
+  // no items are added while running, so once every queue was found empty
+  // there is nothing left to do
+  void Worker(Int_t Thread,
+              const std::function<void(Int_t, std::size_t)> &Work) {
+    std::size_t Item;
+    while (Pop(Thread, Item) || Steal(Thread, Item)) {
+      Work(Thread, Item);
+    }
+  }
+
+  Bool_t Pop(Int_t Thread, std::size_t &Item) {
+    Queue &Q = fQueues[Thread];
+    std::lock_guard<std::mutex> Guard(Q.Lock);
+    if (Q.Items.empty()) {
+      return false;
+    }
+    Item = Q.Items.front();
+    Q.Items.pop_front();
+    return true;
+  }
+
+  Bool_t Steal(Int_t Thread, std::size_t &Item) {
+    for (Int_t i = 1; i < fNThreads; i++) {
+      Queue &Q = fQueues[(Thread + i) % fNThreads];
+      std::lock_guard<std::mutex> Guard(Q.Lock);
+      if (!Q.Items.empty()) {
+        Item = Q.Items.back();
+        Q.Items.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Int_t fNThreads;
+  std::vector<Queue> fQueues;
+};
+
+#endif // FEMTOPOOL_H
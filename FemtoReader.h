@@ -0,0 +1,497 @@
+/*
+ * File              : FemtoReader.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOREADER_H
+#define FEMTOREADER_H
+
+#include <RtypesCore.h>
+#include <TBranch.h>
+#include <TBufferFile.h>
+#include <TDataType.h>
+#include <TDirectoryFile.h>
+#include <TLeaf.h>
+#include <TTree.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// number of particles that are processed together after reading
+static constexpr Long64_t kBatchSize = 4096;
+
+// structure of arrays holding the columns of O2femtodreamparts and
+// O2femtodebugparts of one DF_ directory
+// entry i of every column corresponds to entry i of both trees
+// columns of branches which are not enabled stay empty
+struct ParticleColumns {
+  Long64_t Entries = 0;
+
+  // O2femtodreamparts
+  std::vector<Int_t> CollisionID;
+  std::vector<UChar_t> PartType;
+  std::vector<Float_t> Pt, Eta, Phi, TempFitVar, MLambda, MAntiLambda;
+
+  // O2femtodebugparts
+  std::vector<Char_t> Sign;
+  std::vector<UChar_t> TPCNClsFound, TPCNClsFindable, TPCNClsCrossedRows,
+      TPCNClsShared, ITSNCls, ITSNClsInnerBarrel;
+  std::vector<Float_t> DcaXY, DcaZ, DaughDCA, TransRadius, DecayVtxX,
+      DecayVtxY, DecayVtxZ, MKaon, TPCSignal;
+  std::vector<Char_t> TPCNSigmaStoreEl, TPCNSigmaStorePi, TPCNSigmaStoreKa,
+      TPCNSigmaStorePr, TPCNSigmaStoreDe, TOFNSigmaStoreEl, TOFNSigmaStorePi,
+      TOFNSigmaStoreKa, TOFNSigmaStorePr, TOFNSigmaStoreDe;
+};
+
+// dense collision table of O2femtodreamcols of one DF_ directory
+// indexed directly with fIndexFemtoDreamCollisions
+struct CollisionColumns {
+  Long64_t Entries = 0;
+  std::vector<Float_t> PosZ, MultV0M;
+};
+
+// maps a branch onto the column it is read into
+struct ColumnBinding {
+  const char *Branch;
+  EDataType Type;
+  void *Column;
+};
+
+// reads a whole column of a branch
+// whenever the branch supports it, the column is filled basket by basket with
+// the bulk API, otherwise we fall back to reading entry by entry
+template <typename T>
+Bool_t ReadColumn(TBranch *Branch, std::vector<T> &Column, Long64_t Entries) {
+
+  TLeaf *Leaf = dynamic_cast<TLeaf *>(Branch->GetListOfLeaves()->At(0));
+  if (!Leaf || Leaf->GetLenType() != static_cast<Int_t>(sizeof(T)) ||
+      Leaf->GetLen() != 1) {
+    std::cout << "Branch " << Branch->GetName()
+              << " does not hold the expected type. Skip..." << std::endl;
+    return false;
+  }
+
+  Column.resize(Entries);
+  Long64_t Entry = 0;
+
+  auto &Bulk = Branch->GetBulkRead();
+  if (Bulk.SupportsBulkRead()) {
+    TBufferFile Buffer(TBuffer::kWrite, 32 * 1024);
+    while (Entry < Entries) {
+      Int_t Count = Bulk.GetBulkEntries(Entry, Buffer);
+      if (Count <= 0) {
+        break;
+      }
+      Count = std::min<Long64_t>(Count, Entries - Entry);
+      std::memcpy(Column.data() + Entry, Buffer.GetCurrent(),
+                  Count * sizeof(T));
+      Entry += Count;
+    }
+  }
+
+  // whatever was not covered by the bulk read
+  if (Entry < Entries) {
+    T Value;
+    Branch->SetAddress(&Value);
+    for (; Entry < Entries; Entry++) {
+      Branch->GetEntry(Entry);
+      Column[Entry] = Value;
+    }
+    Branch->ResetAddress();
+  }
+
+  return true;
+}
+
+// call Visit with the column of a binding, cast to its proper type
+template <typename F>
+Bool_t VisitColumn(const ColumnBinding &Binding, F Visit) {
+  switch (Binding.Type) {
+  case kInt_t:
+    Visit(*static_cast<std::vector<Int_t> *>(Binding.Column));
+    return true;
+  case kFloat_t:
+    Visit(*static_cast<std::vector<Float_t> *>(Binding.Column));
+    return true;
+  case kChar_t:
+    Visit(*static_cast<std::vector<Char_t> *>(Binding.Column));
+    return true;
+  case kUChar_t:
+    Visit(*static_cast<std::vector<UChar_t> *>(Binding.Column));
+    return true;
+  default:
+    std::cout << "Unsupported column type for " << Binding.Branch
+              << ". Skip..." << std::endl;
+    return false;
+  }
+}
+
+// bindings of the columns of O2femtodreamparts, O2femtodebugparts and
+// O2femtodreamcols
+inline std::vector<ColumnBinding> PartsBindings(ParticleColumns &Parts) {
+  return {
+      {"fIndexFemtoDreamCollisions", kInt_t, &Parts.CollisionID},
+      {"fPartType", kUChar_t, &Parts.PartType},
+      {"fPt", kFloat_t, &Parts.Pt},
+      {"fEta", kFloat_t, &Parts.Eta},
+      {"fPhi", kFloat_t, &Parts.Phi},
+      {"fTempFitVar", kFloat_t, &Parts.TempFitVar},
+      {"fMLambda", kFloat_t, &Parts.MLambda},
+      {"fMAntiLambda", kFloat_t, &Parts.MAntiLambda},
+  };
+}
+
+inline std::vector<ColumnBinding> DebugBindings(ParticleColumns &Parts) {
+  return {
+      {"fSign", kChar_t, &Parts.Sign},
+      {"fTPCNClsFound", kUChar_t, &Parts.TPCNClsFound},
+      {"fTPCNClsFindable", kUChar_t, &Parts.TPCNClsFindable},
+      {"fTPCNClsCrossedRows", kUChar_t, &Parts.TPCNClsCrossedRows},
+      {"fTPCNClsShared", kUChar_t, &Parts.TPCNClsShared},
+      {"fITSNCls", kUChar_t, &Parts.ITSNCls},
+      {"fITSNClsInnerBarrel", kUChar_t, &Parts.ITSNClsInnerBarrel},
+      {"fDcaXY", kFloat_t, &Parts.DcaXY},
+      {"fDcaZ", kFloat_t, &Parts.DcaZ},
+      {"fDaughDCA", kFloat_t, &Parts.DaughDCA},
+      {"fTransRadius", kFloat_t, &Parts.TransRadius},
+      {"fDecayVtxX", kFloat_t, &Parts.DecayVtxX},
+      {"fDecayVtxY", kFloat_t, &Parts.DecayVtxY},
+      {"fDecayVtxZ", kFloat_t, &Parts.DecayVtxZ},
+      {"fMKaon", kFloat_t, &Parts.MKaon},
+      {"fTPCSignal", kFloat_t, &Parts.TPCSignal},
+      {"fTPCNSigmaStoreEl", kChar_t, &Parts.TPCNSigmaStoreEl},
+      {"fTPCNSigmaStorePi", kChar_t, &Parts.TPCNSigmaStorePi},
+      {"fTPCNSigmaStoreKa", kChar_t, &Parts.TPCNSigmaStoreKa},
+      {"fTPCNSigmaStorePr", kChar_t, &Parts.TPCNSigmaStorePr},
+      {"fTPCNSigmaStoreDe", kChar_t, &Parts.TPCNSigmaStoreDe},
+      {"fTOFNSigmaStoreEl", kChar_t, &Parts.TOFNSigmaStoreEl},
+      {"fTOFNSigmaStorePi", kChar_t, &Parts.TOFNSigmaStorePi},
+      {"fTOFNSigmaStoreKa", kChar_t, &Parts.TOFNSigmaStoreKa},
+      {"fTOFNSigmaStorePr", kChar_t, &Parts.TOFNSigmaStorePr},
+      {"fTOFNSigmaStoreDe", kChar_t, &Parts.TOFNSigmaStoreDe},
+  };
+}
+
+inline std::vector<ColumnBinding> ColsBindings(CollisionColumns &Cols) {
+  return {
+      {"fPosZ", kFloat_t, &Cols.PosZ},
+      {"fMultV0M", kFloat_t, &Cols.MultV0M},
+  };
+}
+
+class FemtoReader {
+public:
+  // only the given branches are read, all others are never decompressed
+  // a directory missing one of Branches is skipped, Optional branches are read
+  // if the directory has them and their columns stay empty otherwise
+  explicit FemtoReader(const std::set<std::string> &Branches,
+                       const std::set<std::string> &Optional = {})
+      : fBranches(Branches), fOptional(Optional),
+        fParticleBindings(PartsBindings(fParticles)),
+        fDebugBindings(DebugBindings(fParticles)),
+        fCollisionBindings(ColsBindings(fCollisions)) {}
+
+  // names of all branches the reader knows about
+  static std::set<std::string> AllBranches() {
+    ParticleColumns Parts;
+    CollisionColumns Cols;
+    std::set<std::string> Branches;
+    for (const auto &Bindings :
+         {PartsBindings(Parts), DebugBindings(Parts), ColsBindings(Cols)}) {
+      for (const auto &Binding : Bindings) {
+        Branches.insert(Binding.Branch);
+      }
+    }
+    return Branches;
+  }
+
+  // bit i is set for the i-th column the reader knows about, in the order of
+  // the particle, debug and collision bindings
+  static ULong64_t ColumnMask(const std::set<std::string> &Branches) {
+    FemtoReader Reader(Branches);
+    ULong64_t Mask = 0;
+    std::vector<ColumnBinding> All = Reader.Bindings();
+    for (std::size_t i = 0; i < All.size(); i++) {
+      if (Branches.count(All[i].Branch) > 0) {
+        Mask |= ULong64_t(1) << i;
+      }
+    }
+    return Mask;
+  }
+
+  // columns of a block written by Serialize, like ColumnMask
+  static ULong64_t BlockColumns(const char *Block, std::size_t Size) {
+    ULong64_t Mask = 0;
+    if (Size >= 3 * sizeof(Long64_t)) {
+      std::memcpy(&Mask, Block + 2 * sizeof(Long64_t), sizeof(Mask));
+    }
+    return Mask;
+  }
+
+  // columns holding a value for every row of their table, like ColumnMask
+  ULong64_t Columns() const {
+    ULong64_t Mask = 0;
+    std::vector<ColumnBinding> All = Bindings();
+    for (std::size_t i = 0; i < All.size(); i++) {
+      Long64_t Entries = i < fParticleBindings.size() + fDebugBindings.size()
+                             ? fParticles.Entries
+                             : fCollisions.Entries;
+      VisitColumn(All[i], [&Mask, i, Entries](auto &Column) {
+        if (static_cast<Long64_t>(Column.size()) == Entries) {
+          Mask |= ULong64_t(1) << i;
+        }
+      });
+    }
+    return Mask;
+  }
+
+  // bindings point into this object
+  FemtoReader(const FemtoReader &) = delete;
+  FemtoReader &operator=(const FemtoReader &) = delete;
+
+  // read all enabled columns of the trees in a DF_ directory
+  // returns false if a tree or a needed branch is missing or a branch holds
+  // an unexpected type, the columns are empty afterwards
+  Bool_t Load(TDirectoryFile *TDirFile) {
+
+    TTree *TreeParts = dynamic_cast<TTree *>(TDirFile->Get("O2femtodreamparts"));
+    TTree *TreeDebugParts =
+        dynamic_cast<TTree *>(TDirFile->Get("O2femtodebugparts"));
+    TTree *TreeCols = dynamic_cast<TTree *>(TDirFile->Get("O2femtodreamcols"));
+
+    if (!TreeParts || !TreeDebugParts || !TreeCols) {
+      std::cout << "One of the trees was not found. Skip..." << std::endl;
+      return false;
+    }
+
+    if (TreeParts->GetEntries() != TreeDebugParts->GetEntries()) {
+      std::cout << "O2femtodreamparts and O2femtodebugparts differ in length. "
+                   "Skip..."
+                << std::endl;
+      return false;
+    }
+
+    // reset by assignment, the bindings keep pointing to the same columns
+    fParticles = ParticleColumns();
+    fCollisions = CollisionColumns();
+    fParticles.Entries = TreeParts->GetEntries();
+    fCollisions.Entries = TreeCols->GetEntries();
+
+    if (!LoadTree(TreeParts, fParticleBindings, fParticles.Entries) ||
+        !LoadTree(TreeDebugParts, fDebugBindings, fParticles.Entries) ||
+        !LoadTree(TreeCols, fCollisionBindings, fCollisions.Entries)) {
+      fParticles = ParticleColumns();
+      fCollisions = CollisionColumns();
+      return false;
+    }
+
+    return true;
+  }
+
+  // keep only the given particle and collision rows, both in ascending order
+  // the collision index of the particles is moved to the new collision rows
+  void Select(const std::vector<Long64_t> &Rows,
+              const std::vector<Long64_t> &CollisionRows) {
+
+    std::vector<Int_t> NewIndex(fCollisions.Entries, -1);
+    for (std::size_t k = 0; k < CollisionRows.size(); k++) {
+      NewIndex[CollisionRows[k]] = k;
+    }
+
+    // rows are ascending, so the columns can be compacted in place
+    auto Compact = [](const std::vector<Long64_t> &Keep) {
+      return [&Keep](auto &Column) {
+        if (Column.empty()) {
+          return;
+        }
+        for (std::size_t k = 0; k < Keep.size(); k++) {
+          Column[k] = Column[Keep[k]];
+        }
+        Column.resize(Keep.size());
+      };
+    };
+    for (const auto &Binding : fParticleBindings) {
+      VisitColumn(Binding, Compact(Rows));
+    }
+    for (const auto &Binding : fDebugBindings) {
+      VisitColumn(Binding, Compact(Rows));
+    }
+    for (const auto &Binding : fCollisionBindings) {
+      VisitColumn(Binding, Compact(CollisionRows));
+    }
+
+    for (auto &Collision : fParticles.CollisionID) {
+      Collision = Collision >= 0 && Collision < fCollisions.Entries
+                      ? NewIndex[Collision]
+                      : -1;
+    }
+    fParticles.Entries = Rows.size();
+    fCollisions.Entries = CollisionRows.size();
+  }
+
+  // write all columns into a flat block
+  // the block holds the number of particles and collisions and the mask of
+  // the columns which were read, followed by every column as its number of
+  // entries (0 if it was not read) and its raw content, padded to 8 bytes
+  void Serialize(std::string &Block) const {
+    Block.clear();
+    auto Append = [&Block](const void *Data, std::size_t Size) {
+      if (Size > 0) {
+        Block.append(static_cast<const char *>(Data), Size);
+      }
+      Block.append((8 - Size % 8) % 8, '\0');
+    };
+    ULong64_t Mask = Columns();
+    Append(&fParticles.Entries, sizeof(Long64_t));
+    Append(&fCollisions.Entries, sizeof(Long64_t));
+    Append(&Mask, sizeof(ULong64_t));
+    for (const auto &Binding : Bindings()) {
+      VisitColumn(Binding, [&Append](auto &Column) {
+        Long64_t Count = Column.size();
+        Append(&Count, sizeof(Long64_t));
+        Append(Column.data(), Count * sizeof(Column[0]));
+      });
+    }
+  }
+
+  // copy the columns back from a block written by Serialize
+  Bool_t Load(const char *Block, std::size_t Size) {
+    const char *End = Block + Size;
+    Bool_t Valid = true;
+    auto Take = [&Block, End, &Valid](void *Data, std::size_t Bytes) {
+      std::size_t Padded = Bytes + (8 - Bytes % 8) % 8;
+      if (!Valid || Block + Padded > End) {
+        Valid = false;
+        return;
+      }
+      if (Bytes > 0) {
+        std::memcpy(Data, Block, Bytes);
+      }
+      Block += Padded;
+    };
+
+    fParticles = ParticleColumns();
+    fCollisions = CollisionColumns();
+    ULong64_t Mask = 0;
+    Take(&fParticles.Entries, sizeof(Long64_t));
+    Take(&fCollisions.Entries, sizeof(Long64_t));
+    Take(&Mask, sizeof(ULong64_t));
+
+    // every column is either empty or as long as its table, the needed ones
+    // must not be empty
+    const std::set<std::string> &Branches = fBranches;
+    auto TakeColumns = [&](const std::vector<ColumnBinding> &List,
+                           Long64_t Entries) {
+      for (const auto &Binding : List) {
+        Bool_t Needed = Branches.count(Binding.Branch) > 0;
+        VisitColumn(Binding, [&Take, &Valid, Entries, Needed](auto &Column) {
+          Long64_t Count = -1;
+          Take(&Count, sizeof(Long64_t));
+          if (!Valid || (Count != 0 && Count != Entries) ||
+              (Needed && Count != Entries)) {
+            Valid = false;
+            return;
+          }
+          Column.resize(Count);
+          Take(Column.data(), Count * sizeof(Column[0]));
+        });
+      }
+    };
+    TakeColumns(fParticleBindings, fParticles.Entries);
+    TakeColumns(fDebugBindings, fParticles.Entries);
+    TakeColumns(fCollisionBindings, fCollisions.Entries);
+
+    if (!Valid) {
+      std::cout << "Corrupted or incomplete skim block. Skip..." << std::endl;
+      fParticles = ParticleColumns();
+      fCollisions = CollisionColumns();
+    }
+    return Valid;
+  }
+
+  // memory the enabled columns take for a DF_ directory of the given size
+  std::size_t Bytes(Long64_t Particles, Long64_t Collisions) const {
+    std::size_t Sum = 0;
+    auto Add = [this, &Sum](const std::vector<ColumnBinding> &List,
+                            Long64_t Entries) {
+      for (const auto &Binding : List) {
+        if (fBranches.count(Binding.Branch) == 0 &&
+            fOptional.count(Binding.Branch) == 0) {
+          continue;
+        }
+        VisitColumn(Binding, [&Sum, Entries](auto &Column) {
+          Sum += Entries * sizeof(Column[0]);
+        });
+      }
+    };
+    Add(fParticleBindings, Particles);
+    Add(fDebugBindings, Particles);
+    Add(fCollisionBindings, Collisions);
+    return Sum;
+  }
+
+  const ParticleColumns &Particles() const { return fParticles; }
+  const CollisionColumns &Collisions() const { return fCollisions; }
+
+private:
+  // returns false if one of the needed branches could not be read
+  // optional branches which are missing or hold another type are left empty
+  Bool_t LoadTree(TTree *Tree, std::vector<ColumnBinding> &Bindings,
+                  Long64_t Entries) {
+
+    // disable everything we do not need, so it is never read by accident
+    Tree->SetBranchStatus("*", false);
+
+    for (auto &Binding : Bindings) {
+      Bool_t Needed = fBranches.count(Binding.Branch) > 0;
+      if (!Needed && fOptional.count(Binding.Branch) == 0) {
+        continue;
+      }
+
+      TBranch *Branch = Tree->GetBranch(Binding.Branch);
+      if (!Branch && !Needed) {
+        continue;
+      }
+      if (!Branch) {
+        std::cout << "Branch " << Binding.Branch << " not found in "
+                  << Tree->GetName() << ". Skip..." << std::endl;
+        return false;
+      }
+      Tree->SetBranchStatus(Binding.Branch, true);
+
+      Bool_t Read = false;
+      if (!VisitColumn(Binding, [Branch, Entries, &Read](auto &Column) {
+            Read = ReadColumn(Branch, Column, Entries);
+            if (!Read) {
+              Column.clear();
+            }
+          }) ||
+          (!Read && Needed)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<ColumnBinding> Bindings() const {
+    std::vector<ColumnBinding> All = fParticleBindings;
+    All.insert(All.end(), fDebugBindings.begin(), fDebugBindings.end());
+    All.insert(All.end(), fCollisionBindings.begin(),
+               fCollisionBindings.end());
+    return All;
+  }
+
+  std::set<std::string> fBranches, fOptional;
+  ParticleColumns fParticles;
+  CollisionColumns fCollisions;
+  std::vector<ColumnBinding> fParticleBindings, fDebugBindings,
+      fCollisionBindings;
+};
+
+#endif // FEMTOREADER_H
@@ -0,0 +1,316 @@
+/*
+ * File              : FemtoSkim.h
+ * Author            : agent <agent@local>
+ * Date              : 16.10.2026
+ * Last Modified Date: 16.10.2026
+ * Last Modified By  : agent <agent@local>
+ */
+
+#ifndef FEMTOSKIM_H
+#define FEMTOSKIM_H
+
+#include <RtypesCore.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "FemtoCuts.h"
+#include "FemtoDerived.h"
+#include "FemtoReader.h"
+
+// 64 bit FNV-1a, used for the names of skim files and the fingerprints of the
+// DF_ directories
+inline ULong64_t SkimHash(const void *Data, std::size_t Size,
+                          ULong64_t Hash = 14695981039346656037ull) {
+  const UChar_t *Bytes = static_cast<const UChar_t *>(Data);
+  for (std::size_t i = 0; i < Size; i++) {
+    Hash = (Hash ^ Bytes[i]) * 1099511628211ull;
+  }
+  return Hash;
+}
+
+inline std::string SkimHex(ULong64_t Hash) {
+  char Hex[17];
+  std::snprintf(Hex, sizeof(Hex), "%016llx", Hash);
+  return Hex;
+}
+
+// hash of the compiled cuts of a single cut set
+inline ULong64_t SkimHash(const FemtoCuts &Cuts) {
+  ULong64_t Hash = SkimHash(nullptr, 0);
+  for (Int_t s = 0; s < kNCutSpecies; s++) {
+    for (const auto &Cut : Cuts.Program(0, s)) {
+      Int_t Fields[] = {s, Cut.Variable, Cut.Mode, Cut.Gate};
+      Double_t Window[] = {Cut.Min, Cut.Max, Cut.Threshold};
+      Hash = SkimHash(Fields, sizeof(Fields), Hash);
+      Hash = SkimHash(Window, sizeof(Window), Hash);
+    }
+  }
+  return Hash;
+}
+
+// rows of a DF_ directory passing the envelope
+// Lambdas are kept together with both daughters, collisions are kept if they
+// pass the event cuts and hold at least one kept particle
+inline void SkimRows(FemtoCuts &Envelope, const ParticleColumns &Parts,
+                     const CollisionColumns &Cols, std::vector<Long64_t> &Rows,
+                     std::vector<Long64_t> &CollisionRows) {
+
+  // the envelope may need variables nobody registered, compute them per batch
+  static const FemtoDerived NoDerived;
+  std::vector<CutMask> EventMasks;
+  SelectionMasks Masks;
+
+  std::vector<UChar_t> Keep(Parts.Entries, 0);
+  Envelope.SelectCollisions(Parts, Cols, NoDerived, EventMasks);
+  for (Long64_t Begin = 0; Begin < Parts.Entries; Begin += kBatchSize) {
+    Long64_t End = std::min(Begin + kBatchSize, Parts.Entries);
+    Envelope.SelectParticles(Parts, Cols, NoDerived, EventMasks, Begin, End,
+                             Masks);
+    for (Long64_t j = 0; j < End - Begin; j++) {
+      if (Masks.Proton[j] | Masks.Deuteron[j]) {
+        Keep[Begin + j] = 1;
+      }
+      if (Masks.Lambda[j]) {
+        Keep[Begin + j] = Keep[Begin + j + 1] = Keep[Begin + j + 2] = 1;
+      }
+    }
+  }
+
+  Rows.clear();
+  std::vector<UChar_t> KeepCollision(Cols.Entries, 0);
+  for (Long64_t i = 0; i < Parts.Entries; i++) {
+    if (!Keep[i]) {
+      continue;
+    }
+    Rows.push_back(i);
+    Int_t Collision = Parts.CollisionID[i];
+    if (Collision >= 0 && Collision < Cols.Entries) {
+      KeepCollision[Collision] = 1;
+    }
+  }
+
+  CollisionRows.clear();
+  for (Long64_t i = 0; i < Cols.Entries; i++) {
+    if (KeepCollision[i]) {
+      CollisionRows.push_back(i);
+    }
+  }
+}
+
+// skim of one input file
+// the file starts with a header holding the envelope it was made with and a
+// table of blocks, one per DF_ directory, followed by the blocks written by
+// FemtoReader::Serialize
+// the file is mapped into memory and Load copies a block into the columns of
+// a reader, only the pages of the blocks which are read are touched
+class FemtoSkim {
+public:
+  static constexpr UInt_t kVersion = 2;
+
+  struct Entry {
+    char Name[64];
+    ULong64_t Fingerprint;
+    ULong64_t Offset;
+    ULong64_t Size;
+  };
+
+  // a new skim which is written with the given envelope
+  FemtoSkim(const std::string &FileName, const FemtoCuts &Envelope)
+      : fFileName(FileName), fEnvelope(Envelope) {}
+
+  // map an existing skim, check Valid() afterwards
+  explicit FemtoSkim(const std::string &FileName)
+      : fFileName(FileName), fEnvelope(Map()) {}
+
+  ~FemtoSkim() { Unmap(); }
+
+  // the mapping belongs to this object
+  FemtoSkim(const FemtoSkim &) = delete;
+  FemtoSkim &operator=(const FemtoSkim &) = delete;
+
+  Bool_t Valid() const { return fValid; }
+  const std::string &FileName() const { return fFileName; }
+  const FemtoCuts &Envelope() const { return fEnvelope; }
+
+  // index of the block of a DF_ directory, -1 if there is none, the
+  // directory changed since it was skimmed or the block misses one of the
+  // Needed columns (see FemtoReader::ColumnMask)
+  Int_t Find(const std::string &Name, ULong64_t Fingerprint,
+             ULong64_t Needed) const {
+    for (std::size_t b = 0; b < fEntries.size(); b++) {
+      if (Name == fEntries[b].Name && Fingerprint == fEntries[b].Fingerprint) {
+        ULong64_t Columns = FemtoReader::BlockColumns(Block(b), BlockSize(b));
+        return (Needed & ~Columns) == 0 ? static_cast<Int_t>(b) : -1;
+      }
+    }
+    return -1;
+  }
+
+  const char *Block(Int_t Index) const {
+    return fData + fEntries[Index].Offset;
+  }
+  std::size_t BlockSize(Int_t Index) const { return fEntries[Index].Size; }
+
+  // write the skim with the given blocks
+  // the file is replaced at once, so an interrupted run never leaves a
+  // broken skim behind
+  Bool_t Write(const std::vector<std::string> &Names,
+               const std::vector<ULong64_t> &Fingerprints,
+               const std::vector<std::pair<const char *, std::size_t>> &Blocks)
+      const {
+
+    std::vector<Char_t> Header;
+    auto Append = [&Header](const void *Data, std::size_t Size) {
+      const Char_t *Bytes = static_cast<const Char_t *>(Data);
+      Header.insert(Header.end(), Bytes, Bytes + Size);
+    };
+
+    Append(kMagic, sizeof(kMagic));
+    UInt_t Version = kVersion, NBlocks = Blocks.size();
+    Append(&Version, sizeof(Version));
+    Append(&NBlocks, sizeof(NBlocks));
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      ULong64_t NCuts = fEnvelope.Program(0, s).size();
+      Append(&NCuts, sizeof(NCuts));
+      for (const auto &Cut : fEnvelope.Program(0, s)) {
+        SkimCut Stored = {Cut.Variable, Cut.Mode, Cut.Gate, 0,
+                          Cut.Min,      Cut.Max,  Cut.Threshold};
+        Append(&Stored, sizeof(Stored));
+      }
+    }
+
+    ULong64_t Offset = Header.size() + Blocks.size() * sizeof(Entry);
+    for (std::size_t b = 0; b < Blocks.size(); b++) {
+      Entry E = {};
+      std::strncpy(E.Name, Names[b].c_str(), sizeof(E.Name) - 1);
+      E.Fingerprint = Fingerprints[b];
+      E.Offset = Offset;
+      E.Size = Blocks[b].second;
+      Append(&E, sizeof(E));
+      Offset += E.Size;
+    }
+
+    std::string Temporary = fFileName + ".tmp";
+    std::ofstream Out(Temporary, std::ios::binary);
+    Out.write(Header.data(), Header.size());
+    for (const auto &Block : Blocks) {
+      Out.write(Block.first, Block.second);
+    }
+    Out.close();
+
+    if (!Out || std::rename(Temporary.c_str(), fFileName.c_str()) != 0) {
+      std::cout << "Could not write skim " << fFileName << ". Skip..."
+                << std::endl;
+      std::remove(Temporary.c_str());
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static constexpr char kMagic[8] = {'F', 'E', 'M', 'T', 'O', 'S', 'K', 'M'};
+
+  // cuts as stored in the header
+  struct SkimCut {
+    Int_t Variable, Mode, Gate, Padding;
+    Double_t Min, Max, Threshold;
+  };
+
+  // map the file and read the envelope from the header
+  FemtoCuts Map() {
+    std::vector<CutInstruction> Programs[kNCutSpecies];
+
+    Int_t Descriptor = open(fFileName.c_str(), O_RDONLY);
+    struct stat Info;
+    if (Descriptor < 0 || fstat(Descriptor, &Info) != 0 || Info.st_size == 0) {
+      if (Descriptor >= 0) {
+        close(Descriptor);
+      }
+      return FemtoCuts("Envelope", Programs);
+    }
+    void *Data = mmap(nullptr, Info.st_size, PROT_READ, MAP_PRIVATE,
+                      Descriptor, 0);
+    close(Descriptor);
+    if (Data == MAP_FAILED) {
+      return FemtoCuts("Envelope", Programs);
+    }
+    fData = static_cast<const char *>(Data);
+    fSize = Info.st_size;
+
+    const char *Current = fData, *End = fData + fSize;
+    auto Take = [&Current, End](void *Out, std::size_t Size) {
+      if (Current + Size > End) {
+        return false;
+      }
+      std::memcpy(Out, Current, Size);
+      Current += Size;
+      return true;
+    };
+
+    char Magic[sizeof(kMagic)];
+    UInt_t Version = 0, NBlocks = 0;
+    if (!Take(Magic, sizeof(Magic)) ||
+        std::memcmp(Magic, kMagic, sizeof(kMagic)) != 0 ||
+        !Take(&Version, sizeof(Version)) || Version != kVersion ||
+        !Take(&NBlocks, sizeof(NBlocks))) {
+      return FemtoCuts("Envelope", Programs);
+    }
+
+    for (Int_t s = 0; s < kNCutSpecies; s++) {
+      ULong64_t NCuts = 0;
+      if (!Take(&NCuts, sizeof(NCuts))) {
+        return FemtoCuts("Envelope", Programs);
+      }
+      for (ULong64_t i = 0; i < NCuts; i++) {
+        SkimCut Stored;
+        if (!Take(&Stored, sizeof(Stored)) || Stored.Variable < 0 ||
+            Stored.Variable >= kNCutVariables) {
+          return FemtoCuts("Envelope", Programs);
+        }
+        Programs[s].push_back({static_cast<CutVariable>(Stored.Variable),
+                               Stored.Min, Stored.Max,
+                               static_cast<CutMode>(Stored.Mode),
+                               static_cast<CutGate>(Stored.Gate),
+                               Stored.Threshold});
+      }
+    }
+
+    fEntries.resize(NBlocks);
+    for (auto &E : fEntries) {
+      if (!Take(&E, sizeof(E)) || E.Offset + E.Size > fSize) {
+        fEntries.clear();
+        return FemtoCuts("Envelope", Programs);
+      }
+      E.Name[sizeof(E.Name) - 1] = '\0';
+    }
+
+    fValid = true;
+    return FemtoCuts("Envelope", Programs);
+  }
+
+  void Unmap() {
+    if (fData) {
+      munmap(const_cast<char *>(fData), fSize);
+    }
+    fData = nullptr;
+    fSize = 0;
+  }
+
+  std::string fFileName;
+  const char *fData = nullptr;
+  std::size_t fSize = 0;
+  Bool_t fValid = false;
+  std::vector<Entry> fEntries;
+  FemtoCuts fEnvelope;
+};
+
+#endif // FEMTOSKIM_H
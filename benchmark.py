@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+# -*- coding:utf-8 -*-
+# File              : benchmark.py
+# Author            : agent <agent@local>
+# Date              : 16.10.2026
+# Last Modified Date: 16.10.2026
+# Last Modified By  : agent <agent@local>
+
+import ROOT
+import argparse
+import os
+import shutil
+import sys
+import time
+
+from postProcessing import CutSetName, Particles, RawParticles
+
+# cut configs which are benchmarked one by one and all together
+CutConfigs = [
+    "StandardCuts.json",
+    "StandardCuts_NoPid.json",
+    "OpenCuts.json",
+    "OpenCuts_NoPid.json",
+]
+
+# lists of histograms written for every cut set by both versions
+Lists = Particles + RawParticles + ["Event"]
+
+# lists only written by the C++ version
+CppLists = ["Pairs", "CutFlow"]
+
+
+def Run(Command):
+    # run a command and return its output, the wall time and the peak RSS in MB
+    # the process is spawned and reaped by hand, so wait4 gives the resource
+    # usage of this process alone
+    Start = time.perf_counter()
+    Read, Write = os.pipe()
+    Pid = os.posix_spawnp(
+        Command[0],
+        Command,
+        os.environ,
+        file_actions=[
+            (os.POSIX_SPAWN_DUP2, Write, 1),
+            (os.POSIX_SPAWN_DUP2, Write, 2),
+            (os.POSIX_SPAWN_CLOSE, Read),
+        ],
+    )
+    os.close(Write)
+    with os.fdopen(Read) as Pipe:
+        Output = Pipe.read()
+    _, Status, Usage = os.wait4(Pid, 0)
+    Seconds = time.perf_counter() - Start
+    if os.waitstatus_to_exitcode(Status) != 0:
+        print(Output)
+        sys.exit("Command failed: " + " ".join(Command))
+    # ru_maxrss is given in kB on linux
+    return Output, Seconds, Usage.ru_maxrss / 1024
+
+
+def Summary(Output):
+    # numbers printed at the end of a run as "Key Value"
+    Values = {}
+    Stages = {}
+    for Line in Output.splitlines():
+        Fields = Line.split()
+        if len(Fields) == 2 and Fields[0] in ["Particles", "BytesRead"]:
+            Values[Fields[0]] = int(Fields[1])
+        elif len(Fields) == 3 and Fields[0] == "Stage":
+            Stages[Fields[1]] = float(Fields[2])
+    return Values, Stages
+
+
+def RootMacro(Macro, *Arguments):
+    # root command line calling a compiled macro with the given arguments
+    Formatted = []
+    for Argument in Arguments:
+        if isinstance(Argument, str):
+            Formatted.append('"' + Argument + '"')
+        else:
+            Formatted.append(str(Argument))
+    return ["root", "-l", "-q", "-b", Macro + "+(" + ",".join(Formatted) + ")"]
+
+
+def RunCpp(
+    Args, Configs, InputFileName, OutputFileName, Threads, SkimDir="", CutWarmup=0
+):
+    # run postProcessing.C with all configs in a single pass
+    return Run(
+        RootMacro(
+            "postProcessing.C",
+            ",".join(Configs),
+            Args.histconfig,
+            InputFileName,
+            OutputFileName,
+            Threads,
+            SkimDir,
+            CutWarmup,
+        )
+    )
+
+
+def Compare(FileNameA, FileNameB, CutSetNames, ListNames=Lists):
+    # compare all bins including under and overflow of all histograms
+    # return the number of histograms which differ
+    FileA = ROOT.TFile.Open(FileNameA)
+    FileB = ROOT.TFile.Open(FileNameB)
+    Differences = 0
+    for SetName in CutSetNames:
+        for ListName in ListNames:
+            ListA = FileA.Get(SetName + "/" + ListName)
+            ListB = FileB.Get(SetName + "/" + ListName)
+            if not ListA or not ListB:
+                print("Missing list {}/{}".format(SetName, ListName))
+                Differences += 1
+                continue
+            for HistA in ListA:
+                HistB = ListB.FindObject(HistA.GetName())
+                if not HistB or HistA.GetNcells() != HistB.GetNcells():
+                    print(
+                        "Missing or different binning of {}/{}/{}".format(
+                            SetName, ListName, HistA.GetName()
+                        )
+                    )
+                    Differences += 1
+                    continue
+                for Bin in range(HistA.GetNcells()):
+                    if HistA.GetBinContent(Bin) != HistB.GetBinContent(Bin):
+                        print(
+                            "Bin {} of {}/{}/{} differs: {} vs {}".format(
+                                Bin,
+                                SetName,
+                                ListName,
+                                HistA.GetName(),
+                                HistA.GetBinContent(Bin),
+                                HistB.GetBinContent(Bin),
+                            )
+                        )
+                        Differences += 1
+                        break
+    FileA.Close()
+    FileB.Close()
+    return Differences
+
+
+def main(Args):
+
+    os.makedirs(Args.workdir, exist_ok=True)
+    InputFileName = os.path.join(Args.workdir, "AO2D_synthetic.root")
+
+    # synthetic input
+    Output, Seconds, _ = Run(
+        RootMacro(
+            "generateAO2D.C",
+            InputFileName,
+            Args.directories,
+            Args.collisions,
+            float(Args.tracks),
+            float(Args.v0s),
+            Args.ordering,
+            Args.seed,
+        )
+    )
+    NParticles = Summary(Output)[0]["Particles"]
+    FileSize = os.path.getsize(InputFileName) / 1e6
+    print(
+        "Generated {} particles, {:.1f} MB in {:.1f} s".format(
+            NParticles, FileSize, Seconds
+        )
+    )
+
+    # every config on its own and all of them in a single pass
+    # MB/s is the size of the input file on disk over the wall time for both
+    # versions
+    Runs = [[Config] for Config in CutConfigs] + [CutConfigs]
+    print("{:<24} MB/s of the input file on disk".format(""))
+
+    # compile the macro once, so the timed runs do not include ACLiC
+    Run(
+        RootMacro(
+            "postProcessing.C",
+            CutConfigs[0],
+            Args.histconfig,
+            InputFileName,
+            os.path.join(Args.workdir, "Warmup.root"),
+            Args.threads,
+        )
+    )
+
+    Failed = False
+    for Configs in Runs:
+        Name = "All" if len(Configs) > 1 else CutSetName(Configs[0])
+        CutSetNames = [CutSetName(Config) for Config in Configs]
+
+        # with the cuts in the order of the config and reordered after a
+        # warm-up, the cut stage shows what the reordering saves
+        OutputCpp = os.path.join(Args.workdir, "Output_" + Name + "_cpp.root")
+        Variants = [("C++", 0, OutputCpp)]
+        if Args.cut_warmup > 0:
+            OutputCw = os.path.join(Args.workdir, "Output_" + Name + "_cpp_cw.root")
+            Variants.append(("C++ cw", Args.cut_warmup, OutputCw))
+        for Label, CutWarmup, OutputFileName in Variants:
+            Output, Seconds, Memory = RunCpp(
+                Args,
+                Configs,
+                InputFileName,
+                OutputFileName,
+                Args.threads,
+                "",
+                CutWarmup,
+            )
+            Values, Stages = Summary(Output)
+            print(
+                "{:<24} {:<6} {:8.2f} s {:12.0f} particles/s {:8.1f} MB/s {:8.1f} MB RSS".format(
+                    Name,
+                    Label,
+                    Seconds,
+                    Values.get("Particles", 0) / Seconds,
+                    FileSize / Seconds,
+                    Memory,
+                )
+            )
+            print(
+                "{:<24} stages ".format("")
+                + " ".join("{} {:.3f} s".format(S, T) for S, T in Stages.items())
+            )
+
+        if Args.skip_python:
+            continue
+
+        OutputPy = os.path.join(Args.workdir, "Output_" + Name + "_py.root")
+        _, Seconds, Memory = Run(
+            [
+                sys.executable,
+                "postProcessing.py",
+                InputFileName,
+                OutputPy,
+                Args.histconfig,
+            ]
+            + Configs
+        )
+        print(
+            "{:<24} Python {:8.2f} s {:12.0f} particles/s {:8.1f} MB/s {:8.1f} MB RSS".format(
+                Name, Seconds, NParticles / Seconds, FileSize / Seconds, Memory
+            )
+        )
+
+        Differences = Compare(OutputCpp, OutputPy, CutSetNames)
+        print(
+            "{:<24} histograms {}".format(
+                Name,
+                "identical" if Differences == 0 else str(Differences) + " differ",
+            )
+        )
+        Failed = Failed or Differences > 0
+
+    Failed = Consistency(Args, InputFileName) or Failed
+
+    return 1 if Failed else 0
+
+
+def Consistency(Args, InputFileName):
+    # the C++ output must not depend on the number of threads or on whether the
+    # input was skimmed, return True if it does
+    CutSetNames = [CutSetName(Config) for Config in CutConfigs]
+    AllLists = Lists + CppLists
+    Failed = False
+
+    def Check(Name, FileNameA, FileNameB, ListNames):
+        Differences = Compare(FileNameA, FileNameB, CutSetNames, ListNames)
+        print(
+            "{:<24} histograms {}".format(
+                Name,
+                "identical" if Differences == 0 else str(Differences) + " differ",
+            )
+        )
+        return Differences > 0
+
+    Reference = os.path.join(Args.workdir, "Output_All_1thread.root")
+    RunCpp(Args, CutConfigs, InputFileName, Reference, 1)
+    Threaded = os.path.join(Args.workdir, "Output_All_threads.root")
+    RunCpp(Args, CutConfigs, InputFileName, Threaded, Args.threads)
+    Failed = Check("1 vs N threads", Reference, Threaded, AllLists) or Failed
+
+    # the cut order is decided before the threads start, so the cut flow with
+    # reordered cuts must not depend on the threads either, and the histograms
+    # and pairs must not depend on the order
+    Reordered = os.path.join(Args.workdir, "Output_All_1thread_warmup.root")
+    RunCpp(Args, CutConfigs, InputFileName, Reordered, 1, "", Args.cut_warmup)
+    Failed = Check("reordered cuts", Reference, Reordered, Lists + ["Pairs"]) or Failed
+    ReorderedThreaded = os.path.join(Args.workdir, "Output_All_threads_warmup.root")
+    RunCpp(
+        Args,
+        CutConfigs,
+        InputFileName,
+        ReorderedThreaded,
+        Args.threads,
+        "",
+        Args.cut_warmup,
+    )
+    Failed = (
+        Check("1 vs N threads warmup", Reordered, ReorderedThreaded, AllLists)
+        or Failed
+    )
+
+    # the first run builds the skim from the whole input, the second one reads
+    # it and leaves out what a skim cannot reproduce
+    SkimDir = os.path.join(Args.workdir, "Skims")
+    shutil.rmtree(SkimDir, ignore_errors=True)
+    Building = os.path.join(Args.workdir, "Output_All_skim_build.root")
+    RunCpp(Args, CutConfigs, InputFileName, Building, Args.threads, SkimDir)
+    Failed = Check("skim build", Reference, Building, AllLists) or Failed
+
+    Reading = os.path.join(Args.workdir, "Output_All_skim_read.root")
+    RunCpp(Args, CutConfigs, InputFileName, Reading, Args.threads, SkimDir)
+    Failed = Check("skim read", Reference, Reading, Particles + ["Pairs"]) or Failed
+
+    File = ROOT.TFile.Open(Reading)
+    Marked = bool(File.Get("Skimmed")) and not any(
+        File.Get(Name + "/" + ListName)
+        for Name in CutSetNames
+        for ListName in RawParticles + ["Event", "CutFlow"]
+    )
+    File.Close()
+    print("{:<24} {}".format("skim read", "marked" if Marked else "not marked"))
+
+    return Failed or not Marked
+
+
+if __name__ == "__main__":
+
+    # input handling
+    Parser = argparse.ArgumentParser(
+        description="Benchmark postProcessing.C and postProcessing.py on synthetic AO2D files"
+    )
+    Parser.add_argument("--workdir", default="Benchmark")
+    Parser.add_argument("--histconfig", default="HistConfig.json")
+    Parser.add_argument("--directories", type=int, default=4)
+    Parser.add_argument("--collisions", type=int, default=500)
+    Parser.add_argument("--tracks", type=float, default=20)
+    Parser.add_argument("--v0s", type=float, default=2)
+    Parser.add_argument(
+        "--ordering", default="Interleaved", choices=["Interleaved", "TracksFirst"]
+    )
+    Parser.add_argument("--seed", type=int, default=42)
+    Parser.add_argument("--threads", type=int, default=4)
+    Parser.add_argument(
+        "--cut-warmup",
+        type=int,
+        default=10000,
+        help="candidates sampled to reorder the cuts, 0 skips the reordered runs",
+    )
+    Parser.add_argument(
+        "--skip-python",
+        action="store_true",
+        help="only time the C++ version, the histograms are not compared",
+    )
+
+    sys.exit(main(Parser.parse_args()))
@@ -2,23 +2,34 @@
 # File              : exeScript.sh
 # Author            : Anton Riedel <anton.riedel@tum.de>
 # Date              : 14.07.2021
-# Last Modified Date: 25.11.2022
-# Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+# Last Modified Date: 16.10.2026
+# Last Modified By  : agent <agent@local>
 
-Index="0"
+# all cut sets are checked in a single pass over the input files
+# each one ends up in its own directory of the output file
+# the DF_ directories of all files in the list are distributed over Threads
+# threads, given as second argument
+# every thread keeps its own copy of all histograms, the memory this takes per
+# thread is printed at the start
+Threads=${2:-4}
+root -l -q -b postProcessing.C+\(\"StandardCuts.json,StandardCuts_NoPid.json,OpenCuts.json,OpenCuts_NoPid.json\",\"HistConfig.json\",\"$1\",\"Output.root\",$Threads\)
 
-while read -r DataFile; do
-    echo "Working on $DataFile"
-    # root -l -q -b postProcessing.C+\(\"StandardCuts.json\",\"HistConfig.json\",\"$DataFile\"\,\"Output_StandardCuts_OUT-${Index}.root\"\)
-    # root -l -q -b postProcessing.C+\(\"StandardCuts_NoPid.json\",\"HistConfig.json\",\"$DataFile\"\,\"Output_StandardCuts_NoPid_OUT-${Index}.root\"\)
-    # root -l -q -b postProcessing.C+\(\"OpenCuts.json\",\"HistConfig.json\",\"$DataFile\"\,\"Output_OpenCuts_OUT-${Index}.root\"\)
-    # root -l -q -b postProcessing.C+\(\"OpenCuts_NoPid.json\",\"HistConfig.json\",\"$DataFile\"\,\"Output_OpenCuts_NoPid_OUT-${Index}.root\"\)
-    ./postProcessing.py "$DataFile" "Output_StandardCuts_OUT-${Index}.root" "HistConfig.json" "StandardCuts.json" &
-    ./postProcessing.py "$DataFile" "Output_StandardCuts_NoPid_OUT-${Index}.root" "HistConfig.json" "StandardCuts_NoPid.json" &
-    ./postProcessing.py "$DataFile" "Output_OpenCuts_OUT-${Index}.root" "HistConfig.json" "OpenCuts.json" &
-    ./postProcessing.py "$DataFile" "Output_OpenCuts_NoPid_OUT-${Index}.root" "HistConfig.json" "OpenCuts_NoPid.json" &
-    wait
-    ((Index++))
-done <$1
+# with a skim directory as last argument, every input file is reduced to what
+# passes the loosest of the cut sets and reruns with tighter cuts only read
+# the skims
+# root -l -q -b postProcessing.C+\(\"StandardCuts.json,StandardCuts_NoPid.json,OpenCuts.json,OpenCuts_NoPid.json\",\"HistConfig.json\",\"$1\",\"Output.root\",$Threads,\"Skims\"\)
+
+# the python version processes one file at a time
+# Index="0"
+# while read -r DataFile; do
+#     echo "Working on $DataFile"
+#     ./postProcessing.py "$DataFile" "Output_OUT-${Index}.root" "HistConfig.json" \
+#         "StandardCuts.json" "StandardCuts_NoPid.json" "OpenCuts.json" "OpenCuts_NoPid.json"
+#     ((Index++))
+# done <$1
+
+# throughput of both versions on synthetic AO2D files, the histograms of the
+# C++ and python version are checked to be identical
+# ./benchmark.py --threads $Threads
 
 exit 0
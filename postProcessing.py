@@ -3,14 +3,15 @@
 # File              : postProcessing.py
 # Author            : Anton Riedel <anton.riedel@tum.de>
 # Date              : 10.11.2022
-# Last Modified Date: 02.12.2022
-# Last Modified By  : Anton Riedel <anton.riedel@tum.de>
+# Last Modified Date: 16.10.2026
+# Last Modified By  : agent <agent@local>
 
 import ROOT
 import json
 import numpy as np
 import uproot
 import sys
+import os
 
 Particles = [
     "Proton",
@@ -96,11 +97,7 @@ def CheckEvent(CollisionCuts, CollisionTree, Index):
         return False
 
 
-def CheckProton(ProtonCuts, ParticleTree, ParticleDebugTree, Index):
-    TPCCrossedRowsOverFindable = float(
-        ParticleDebugTree["fTPCNClsCrossedRows"][Index]
-    ) / float(ParticleDebugTree["fTPCNClsFindable"][Index])
-
+def CheckProton(ProtonCuts, ParticleTree, ParticleDebugTree, Derived, Index):
     if (
         CheckCut(ProtonCuts, "Charge", ParticleDebugTree, "fSign", Index)
         and CheckCut(ProtonCuts, "Pt", ParticleTree, "fPt", Index)
@@ -117,40 +114,30 @@ def CheckProton(ProtonCuts, ParticleTree, ParticleDebugTree, Index):
             "fTPCNClsCrossedRows",
             Index,
         )
-        and ProtonCuts["TPCCrossedRowsOverFindable"][0]
-        <= TPCCrossedRowsOverFindable
-        <= ProtonCuts["TPCCrossedRowsOverFindable"][1]
+        and CheckCut(
+            ProtonCuts,
+            "TPCCrossedRowsOverFindable",
+            Derived,
+            "TPCCrossedRowsOverFindable",
+            Index,
+        )
         and CheckCut(
             ProtonCuts, "TPCClustersShared", ParticleDebugTree, "fTPCNClsShared", Index
         )
     ):
-        P = ParticleTree["fPt"][Index] * np.cosh(ParticleTree["fEta"][Index])
-        TPC = ConvertBin(ParticleDebugTree["fTPCNSigmaStorePr"][Index])
-        TOF = ConvertBin(ParticleDebugTree["fTOFNSigmaStorePr"][Index])
-        if P <= ProtonCuts["Proton_PTPC"]:
-            if ProtonCuts["NSigmaTPC"][0] <= TPC <= ProtonCuts["NSigmaTPC"][1]:
-                return True
-            else:
-                return False
+        if Derived["P"][Index] <= ProtonCuts["Proton_PTPC"]:
+            return CheckCut(
+                ProtonCuts, "NSigmaTPC", Derived, "fTPCNSigmaStorePr", Index
+            )
         else:
-            if (
-                ProtonCuts["NSigmaTPCTOF"][0]
-                <= np.sqrt(TPC**2 + TOF**2)
-                <= ProtonCuts["NSigmaTPCTOF"][1]
-            ):
-                return True
-            else:
-                return False
+            return CheckCut(
+                ProtonCuts, "NSigmaTPCTOF", Derived, "NSigmaTPCTOFPr", Index
+            )
     else:
         return False
 
 
-def CheckDeuteron(DeuteronCuts, ParticleTree, ParticleDebugTree, Index):
-    TPCCrossedRowsOverFindable = float(
-        ParticleDebugTree["fTPCNClsCrossedRows"][Index]
-    ) / float(ParticleDebugTree["fTPCNClsFindable"][Index])
-    TPC = ConvertBin(ParticleDebugTree["fTPCNSigmaStoreDe"][Index])
-
+def CheckDeuteron(DeuteronCuts, ParticleTree, ParticleDebugTree, Derived, Index):
     if (
         CheckCut(DeuteronCuts, "Charge", ParticleDebugTree, "fSign", Index)
         and CheckCut(DeuteronCuts, "Pt", ParticleTree, "fPt", Index)
@@ -167,9 +154,13 @@ def CheckDeuteron(DeuteronCuts, ParticleTree, ParticleDebugTree, Index):
             "fTPCNClsCrossedRows",
             Index,
         )
-        and DeuteronCuts["TPCCrossedRowsOverFindable"][0]
-        <= TPCCrossedRowsOverFindable
-        <= DeuteronCuts["TPCCrossedRowsOverFindable"][1]
+        and CheckCut(
+            DeuteronCuts,
+            "TPCCrossedRowsOverFindable",
+            Derived,
+            "TPCCrossedRowsOverFindable",
+            Index,
+        )
         and CheckCut(
             DeuteronCuts,
             "TPCClustersShared",
@@ -185,21 +176,16 @@ def CheckDeuteron(DeuteronCuts, ParticleTree, ParticleDebugTree, Index):
             "fITSNClsInnerBarrel",
             Index,
         )
-        and DeuteronCuts["NSigmaTPC"][0] <= TPC <= DeuteronCuts["NSigmaTPC"][1]
+        and CheckCut(DeuteronCuts, "NSigmaTPC", Derived, "fTPCNSigmaStoreDe", Index)
     ):
-        TPC_Proton = ConvertBin(ParticleDebugTree["fTPCNSigmaStorePr"][Index])
-        TPC_Pion = ConvertBin(ParticleDebugTree["fTPCNSigmaStorePi"][Index])
-        TPC_Electron = ConvertBin(ParticleDebugTree["fTPCNSigmaStoreEl"][Index])
         if (
-            DeuteronCuts["TPCRejection"][0]
-            <= TPC_Proton
-            <= DeuteronCuts["TPCRejection"][1]
-            or DeuteronCuts["TPCRejection"][0]
-            <= TPC_Pion
-            <= DeuteronCuts["TPCRejection"][1]
-            or DeuteronCuts["TPCRejection"][0]
-            <= TPC_Electron
-            <= DeuteronCuts["TPCRejection"][1]
+            CheckCut(DeuteronCuts, "TPCRejection", Derived, "fTPCNSigmaStorePr", Index)
+            or CheckCut(
+                DeuteronCuts, "TPCRejection", Derived, "fTPCNSigmaStorePi", Index
+            )
+            or CheckCut(
+                DeuteronCuts, "TPCRejection", Derived, "fTPCNSigmaStoreEl", Index
+            )
         ):
             return False
         else:
@@ -208,12 +194,7 @@ def CheckDeuteron(DeuteronCuts, ParticleTree, ParticleDebugTree, Index):
         return False
 
 
-def CheckLambda(LambdaCuts, ParticleTree, ParticleDebugTree, Index, PrimaryVertex):
-    DecayVertexDist = np.sqrt(
-        (ParticleDebugTree["fDecayVtxX"][Index] - PrimaryVertex[0]) ** 2
-        + (ParticleDebugTree["fDecayVtxY"][Index] - PrimaryVertex[1]) ** 2
-        + (ParticleDebugTree["fDecayVtxZ"][Index] - PrimaryVertex[2]) ** 2
-    )
+def CheckLambda(LambdaCuts, ParticleTree, ParticleDebugTree, Derived, Index):
     if (
         CheckCut(LambdaCuts, "Pt", ParticleTree, "fPt", Index)
         and CheckCut(LambdaCuts, "Eta", ParticleTree, "fEta", Index)
@@ -221,9 +202,7 @@ def CheckLambda(LambdaCuts, ParticleTree, ParticleDebugTree, Index, PrimaryVerte
         and CheckCut(
             LambdaCuts, "TransRadius", ParticleDebugTree, "fTransRadius", Index
         )
-        and LambdaCuts["DecayVertexDist"][0]
-        <= DecayVertexDist
-        <= LambdaCuts["DecayVertexDist"][1]
+        and CheckCut(LambdaCuts, "DecayVertexDist", Derived, "DecayVertexDist", Index)
         and CheckCut(LambdaCuts, "DaughterDCA", ParticleDebugTree, "fDaughDCA", Index)
         and CheckCut(LambdaCuts, "LambdaInvMass", ParticleTree, "fMLambda", Index)
         and not CheckCut(LambdaCuts, "K0InvMass", ParticleDebugTree, "fMKaon", Index)
@@ -233,22 +212,18 @@ def CheckLambda(LambdaCuts, ParticleTree, ParticleDebugTree, Index, PrimaryVerte
         return False
 
 
-def CheckDaugher(DaughterCuts, ParticleTree, ParticleDebugTree, Index, TPCNSigmaBranch):
-    DCAPrimaryVertex = np.sqrt(
-        ParticleDebugTree["fDcaXY"][Index] ** 2 + ParticleDebugTree["fDcaZ"][Index] ** 2
-    )
-    TPC = ConvertBin(ParticleDebugTree[TPCNSigmaBranch][Index])
+def CheckDaugher(
+    DaughterCuts, ParticleTree, ParticleDebugTree, Derived, Index, TPCNSigmaBranch
+):
     if (
         CheckCut(DaughterCuts, "Charge", ParticleDebugTree, "fSign", Index)
         and CheckCut(DaughterCuts, "Eta", ParticleTree, "fEta", Index)
         and CheckCut(
             DaughterCuts, "TPCClustersFound", ParticleDebugTree, "fTPCNClsFound", Index
         )
-        and DaughterCuts["NSigmaTPC"][0] <= TPC <= DaughterCuts["NSigmaTPC"][1]
-        and not (
-            DaughterCuts["DCAPrimaryVertex"][0]
-            <= DCAPrimaryVertex
-            <= DaughterCuts["DCAPrimaryVertex"][1]
+        and CheckCut(DaughterCuts, "NSigmaTPC", Derived, TPCNSigmaBranch, Index)
+        and not CheckCut(
+            DaughterCuts, "DCAPrimaryVertex", Derived, "DCAPrimaryVertex", Index
         )
     ):
         return True
@@ -276,39 +251,71 @@ def ConvertBin(Input):
     return Output
 
 
+# ConvertBin of all possible int8 values, index is the value + 128
+NSigmaTable = np.array([ConvertBin(Input) for Input in range(-128, 128)])
+
+NSigmaBranches = [
+    "fTPCNSigmaStoreEl",
+    "fTPCNSigmaStorePi",
+    "fTPCNSigmaStorePr",
+    "fTPCNSigmaStoreDe",
+    "fTOFNSigmaStorePi",
+    "fTOFNSigmaStorePr",
+    "fTOFNSigmaStoreDe",
+]
+
+
+def ComputeDerived(ParticleTree, ParticleDebugTree, EventTree):
+    # quantities that cannot be pulled from the trees
+    # computed once for all particles of a directory, shared by all cuts and histograms
+    Derived = {}
+    for Branch in NSigmaBranches:
+        Derived[Branch] = NSigmaTable[ParticleDebugTree[Branch].astype(np.int16) + 128]
+    Derived["NSigmaTPCTOFPr"] = np.sqrt(
+        Derived["fTPCNSigmaStorePr"] ** 2 + Derived["fTOFNSigmaStorePr"] ** 2
+    )
+    Derived["P"] = ParticleTree["fPt"] * np.cosh(ParticleTree["fEta"])
+    Findable = ParticleDebugTree["fTPCNClsFindable"].astype(np.float64)
+    Derived["TPCCrossedRowsOverFindable"] = np.divide(
+        ParticleDebugTree["fTPCNClsCrossedRows"].astype(np.float64),
+        Findable,
+        out=np.full_like(Findable, 3.0),
+        where=Findable != 0,
+    )
+    Derived["DCAPrimaryVertex"] = np.sqrt(
+        ParticleDebugTree["fDcaXY"] ** 2 + ParticleDebugTree["fDcaZ"] ** 2
+    )
+    # the primary vertex is approximated by (0, 0, z) of the collision
+    PosZ = EventTree["fPosZ"][ParticleTree["fIndexFemtoDreamCollisions"]]
+    Derived["DecayVertexDist"] = np.sqrt(
+        ParticleDebugTree["fDecayVtxX"] ** 2
+        + ParticleDebugTree["fDecayVtxY"] ** 2
+        + (ParticleDebugTree["fDecayVtxZ"] - PosZ) ** 2
+    )
+    return Derived
+
+
 def ProcessTrack(
     TreeIndex,
     ParticleTree,
     ParticleDebugTree,
+    Derived,
     Histograms,
     TPCNSigmaBranch,
     TOFNSigmaBranch,
-    PrimaryVertex,
 ):
 
-    # compute quantities that cannot be pulled from tree
-    if ParticleDebugTree["fTPCNClsFindable"][TreeIndex] != 0:
-        TPCCrossedRowsOverFindable = float(
-            ParticleDebugTree["fTPCNClsCrossedRows"][TreeIndex]
-        ) / float(ParticleDebugTree["fTPCNClsFindable"][TreeIndex])
-    else:
-        TPCCrossedRowsOverFindable = 3
-    P = ParticleTree["fPt"][TreeIndex] * np.cosh(ParticleTree["fEta"][TreeIndex])
+    # look up quantities that cannot be pulled from tree
+    P = Derived["P"][TreeIndex]
     if TPCNSigmaBranch != "":
-        TPC = ConvertBin(ParticleDebugTree[TPCNSigmaBranch][TreeIndex])
-        TOF = ConvertBin(ParticleDebugTree[TOFNSigmaBranch][TreeIndex])
+        TPC = Derived[TPCNSigmaBranch][TreeIndex]
+        TOF = Derived[TOFNSigmaBranch][TreeIndex]
     else:
         TPC = 0
         TOF = 0
-    DCAPrimaryVertex = np.sqrt(
-        ParticleDebugTree["fDcaXY"][TreeIndex] ** 2
-        + ParticleDebugTree["fDcaZ"][TreeIndex] ** 2
-    )
-    DecayVertexDist = np.sqrt(
-        (ParticleDebugTree["fDecayVtxX"][TreeIndex] - PrimaryVertex[0]) ** 2
-        + (ParticleDebugTree["fDecayVtxY"][TreeIndex] - PrimaryVertex[1]) ** 2
-        + (ParticleDebugTree["fDecayVtxZ"][TreeIndex] - PrimaryVertex[2]) ** 2
-    )
+    TPCCrossedRowsOverFindable = Derived["TPCCrossedRowsOverFindable"][TreeIndex]
+    DCAPrimaryVertex = Derived["DCAPrimaryVertex"][TreeIndex]
+    DecayVertexDist = Derived["DecayVertexDist"][TreeIndex]
 
     # fill 1D histograms
     Histograms["Charge"].Fill(ParticleDebugTree["fSign"][TreeIndex])
@@ -351,13 +358,39 @@ def ProcessTrack(
     Histograms["NSigmaTOFvsP"].Fill(P, TOF)
 
 
-def main(InputFileName, OutputFile, HistConfigFileName, ConfigFileName):
+def CutSetName(ConfigFileName):
+    # name of the output directory of a cut set, e.g. StandardCuts.json -> StandardCuts
+    return os.path.splitext(os.path.basename(ConfigFileName))[0]
+
 
-    # setup histograms
-    Hists = SetupHistograms(HistConfigFileName)
-    Cuts = SetupCuts(ConfigFileName)
+def SetBits(Mask):
+    # yield the indices of all cut sets whose bit is set in the mask
+    Index = 0
+    while Mask:
+        if Mask & 1:
+            yield Index
+        Mask >>= 1
+        Index += 1
+
+
+def main(InputFileName, OutputFileName, HistConfigFileName, ConfigFileNames):
+
+    # histograms are written explicitly into the directory of their cut set
+    ROOT.TH1.AddDirectory(False)
+
+    # setup histograms and cuts for every cut set
+    # bit i of a pass mask corresponds to CutSets[i]
+    CutSets = []
+    for ConfigFileName in ConfigFileNames:
+        CutSets.append(
+            {
+                "Name": CutSetName(ConfigFileName),
+                "Cuts": SetupCuts(ConfigFileName),
+                "Hists": SetupHistograms(HistConfigFileName),
+                "ProcessedCollisions": set(),
+            }
+        )
 
-    ProcessedCollisions = set()
     CollisionIndex = -1
 
     # open root file with uproot
@@ -372,63 +405,96 @@ def main(InputFileName, OutputFile, HistConfigFileName, ConfigFileName):
         for Dir in Directories:
 
             # and get the trees
+            # they are read once and checked against all cut sets
             TreeParticle = file[Dir + "/O2femtodreamparts;1"].arrays(library="np")
             TreeParticleDebug = file[Dir + "/O2femtodebugparts;1"].arrays(library="np")
             TreeEvents = file[Dir + "/O2femtodreamcols;1"].arrays(library="np")
 
             Entries = np.shape(TreeParticle["fPartType"])[0]
 
+            # derived quantities of all particles, computed once per directory
+            Derived = ComputeDerived(TreeParticle, TreeParticleDebug, TreeEvents)
+
+            # collision indices restart in every directory
+            for CutSet in CutSets:
+                CutSet["ProcessedCollisions"].clear()
+
             # loop through the trees
             for TreeIndex in range(Entries):
 
                 CollisionIndex = TreeParticle["fIndexFemtoDreamCollisions"][TreeIndex]
-                PrimaryVertex = [0, 0, TreeEvents["fPosZ"][CollisionIndex]]
 
                 # cut event
-                if not CheckEvent(Cuts["Event"], TreeEvents, CollisionIndex):
+                EventMask = 0
+                for Bit, CutSet in enumerate(CutSets):
+                    if CheckEvent(CutSet["Cuts"]["Event"], TreeEvents, CollisionIndex):
+                        EventMask |= 1 << Bit
+                if not EventMask:
                     continue
 
-                if CollisionIndex not in ProcessedCollisions:
-                    Hists["Event"]["VertexZ"].Fill(TreeEvents["fPosZ"][CollisionIndex])
-                    Hists["Event"]["Multiplicity"].Fill(
-                        TreeEvents["fMultV0M"][CollisionIndex]
-                    )
-                    ProcessedCollisions.add(CollisionIndex)
+                for Bit in SetBits(EventMask):
+                    CutSet = CutSets[Bit]
+                    if CollisionIndex not in CutSet["ProcessedCollisions"]:
+                        CutSet["Hists"]["Event"]["VertexZ"].Fill(
+                            TreeEvents["fPosZ"][CollisionIndex]
+                        )
+                        CutSet["Hists"]["Event"]["Multiplicity"].Fill(
+                            TreeEvents["fMultV0M"][CollisionIndex]
+                        )
+                        CutSet["ProcessedCollisions"].add(CollisionIndex)
 
                 # if the particle is a track, fill proton and deuteron histsograms
                 if TreeParticle["fPartType"][TreeIndex] == 0:
-                    ProcessTrack(
-                        TreeIndex,
-                        TreeParticle,
-                        TreeParticleDebug,
-                        Hists["RawTrack"],
-                        "",
-                        "",
-                        PrimaryVertex,
-                    )
-                    if CheckProton(
-                        Cuts["Proton"], TreeParticle, TreeParticleDebug, TreeIndex
-                    ):
+                    ProtonMask = 0
+                    DeuteronMask = 0
+                    for Bit in SetBits(EventMask):
+                        Cuts = CutSets[Bit]["Cuts"]
+                        if CheckProton(
+                            Cuts["Proton"],
+                            TreeParticle,
+                            TreeParticleDebug,
+                            Derived,
+                            TreeIndex,
+                        ):
+                            ProtonMask |= 1 << Bit
+                        if CheckDeuteron(
+                            Cuts["Deuteron"],
+                            TreeParticle,
+                            TreeParticleDebug,
+                            Derived,
+                            TreeIndex,
+                        ):
+                            DeuteronMask |= 1 << Bit
+
+                    for Bit in SetBits(EventMask):
+                        ProcessTrack(
+                            TreeIndex,
+                            TreeParticle,
+                            TreeParticleDebug,
+                            Derived,
+                            CutSets[Bit]["Hists"]["RawTrack"],
+                            "",
+                            "",
+                        )
+                    for Bit in SetBits(ProtonMask):
                         ProcessTrack(
                             TreeIndex,
                             TreeParticle,
                             TreeParticleDebug,
-                            Hists["Proton"],
+                            Derived,
+                            CutSets[Bit]["Hists"]["Proton"],
                             "fTPCNSigmaStorePr",
                             "fTOFNSigmaStorePr",
-                            PrimaryVertex,
                         )
-                    if CheckDeuteron(
-                        Cuts["Deuteron"], TreeParticle, TreeParticleDebug, TreeIndex
-                    ):
+                    for Bit in SetBits(DeuteronMask):
                         ProcessTrack(
                             TreeIndex,
                             TreeParticle,
                             TreeParticleDebug,
-                            Hists["Deuteron"],
+                            Derived,
+                            CutSets[Bit]["Hists"]["Deuteron"],
                             "fTPCNSigmaStoreDe",
                             "fTOFNSigmaStoreDe",
-                            PrimaryVertex,
                         )
                 # if the particle is a v0, fill lambda histograms
                 elif TreeParticle["fPartType"][TreeIndex] == 1:
@@ -436,106 +502,138 @@ def main(InputFileName, OutputFile, HistConfigFileName, ConfigFileName):
                     if TreeIndex + 2 >= Entries:
                         break
 
-                    ProcessTrack(
-                        TreeIndex,
-                        TreeParticle,
-                        TreeParticleDebug,
-                        Hists["RawLambda"],
-                        "",
-                        "",
-                        PrimaryVertex,
-                    )
-                    ProcessTrack(
-                        TreeIndex + 1,
-                        TreeParticle,
-                        TreeParticleDebug,
-                        Hists["RawPosDaughter"],
-                        "fTPCNSigmaStorePr",
-                        "fTOFNSigmaStorePr",
-                        PrimaryVertex,
-                    )
-                    ProcessTrack(
-                        TreeIndex + 2,
-                        TreeParticle,
-                        TreeParticleDebug,
-                        Hists["RawNegDaughter"],
-                        "fTPCNSigmaStorePi",
-                        "fTOFNSigmaStorePi",
-                        PrimaryVertex,
-                    )
-                    if (
-                        CheckLambda(
-                            Cuts["Lambda"],
+                    LambdaMask = 0
+                    for Bit in SetBits(EventMask):
+                        Cuts = CutSets[Bit]["Cuts"]
+                        if (
+                            CheckLambda(
+                                Cuts["Lambda"],
+                                TreeParticle,
+                                TreeParticleDebug,
+                                Derived,
+                                TreeIndex,
+                            )
+                            and CheckDaugher(
+                                Cuts["PosDaughter"],
+                                TreeParticle,
+                                TreeParticleDebug,
+                                Derived,
+                                TreeIndex + 1,
+                                "fTPCNSigmaStorePr",
+                            )
+                            and CheckDaugher(
+                                Cuts["NegDaughter"],
+                                TreeParticle,
+                                TreeParticleDebug,
+                                Derived,
+                                TreeIndex + 2,
+                                "fTPCNSigmaStorePi",
+                            )
+                        ):
+                            LambdaMask |= 1 << Bit
+
+                    for Bit in SetBits(EventMask):
+                        Hists = CutSets[Bit]["Hists"]
+                        ProcessTrack(
+                            TreeIndex,
                             TreeParticle,
                             TreeParticleDebug,
-                            TreeIndex,
-                            PrimaryVertex,
+                            Derived,
+                            Hists["RawLambda"],
+                            "",
+                            "",
                         )
-                        and CheckDaugher(
-                            Cuts["PosDaughter"],
+                        ProcessTrack(
+                            TreeIndex + 1,
                             TreeParticle,
                             TreeParticleDebug,
-                            TreeIndex + 1,
+                            Derived,
+                            Hists["RawPosDaughter"],
                             "fTPCNSigmaStorePr",
+                            "fTOFNSigmaStorePr",
                         )
-                        and CheckDaugher(
-                            Cuts["NegDaughter"],
+                        ProcessTrack(
+                            TreeIndex + 2,
                             TreeParticle,
                             TreeParticleDebug,
-                            TreeIndex + 2,
+                            Derived,
+                            Hists["RawNegDaughter"],
                             "fTPCNSigmaStorePi",
+                            "fTOFNSigmaStorePi",
                         )
-                    ):
+                    for Bit in SetBits(LambdaMask):
+                        Hists = CutSets[Bit]["Hists"]
                         ProcessTrack(
                             TreeIndex,
                             TreeParticle,
                             TreeParticleDebug,
+                            Derived,
                             Hists["Lambda"],
                             "",
                             "",
-                            PrimaryVertex,
                         )
                         ProcessTrack(
                             TreeIndex + 1,
                             TreeParticle,
                             TreeParticleDebug,
+                            Derived,
                             Hists["PosDaughter"],
                             "fTPCNSigmaStorePr",
                             "fTOFNSigmaStorePr",
-                            PrimaryVertex,
                         )
                         ProcessTrack(
                             TreeIndex + 2,
                             TreeParticle,
                             TreeParticleDebug,
+                            Derived,
                             Hists["NegDaughter"],
                             "fTPCNSigmaStorePi",
                             "fTOFNSigmaStorePi",
-                            PrimaryVertex,
                         )
 
     # save result into root file
+    # every cut set gets its own directory
     OutputFile = ROOT.TFile(OutputFileName, "recreate")
-    for P in Particles + RawParticles + ["Event"]:
-        List = ROOT.TList()
-        for hist in Hists[P].values():
-            List.Add(hist)
-        List.Write(P, 1)  # 1 = TObject::kSingleKey
+    for CutSet in CutSets:
+        Directory = OutputFile.mkdir(CutSet["Name"])
+        Directory.cd()
+        for P in Particles + RawParticles + ["Event"]:
+            List = ROOT.TList()
+            for hist in CutSet["Hists"][P].values():
+                List.Add(hist)
+            List.Write(P, 1)  # 1 = TObject::kSingleKey
     OutputFile.Close()
 
 
 if __name__ == "__main__":
 
     # input handling
+    # all cut configurations after the histogram config are processed in a single pass
+    if len(sys.argv) < 5:
+        print(
+            "Usage: postProcessing.py InputFile OutputFile HistConfig CutConfig [CutConfig ...]"
+        )
+        sys.exit(1)
     InputFileName = sys.argv[1]
     OutputFileName = sys.argv[2]
     HistConfigFileName = sys.argv[3]
-    ConfigFileName = sys.argv[4]
+    ConfigFileNames = sys.argv[4:]
+
+    # every cut set is written into a directory named after its config file
+    CutSetNames = [CutSetName(ConfigFileName) for ConfigFileName in ConfigFileNames]
+    for Name in CutSetNames:
+        if CutSetNames.count(Name) > 1:
+            print(
+                "Two config files give the cut set name "
+                + Name
+                + ". Rename one of them. Abort..."
+            )
+            sys.exit(1)
 
     # hardcode values for testing
     # InputFileName = "../FemtoAO2D.root"
     # OutputFileName = "test.root"
     # HistConfigFileName = "./HistConfig.json"
-    # ConfigFileName = "./StandardCuts.json"
+    # ConfigFileNames = ["./StandardCuts.json", "./OpenCuts.json"]
 
-    main(InputFileName, OutputFileName, HistConfigFileName, ConfigFileName)
+    main(InputFileName, OutputFileName, HistConfigFileName, ConfigFileNames)